@@ -28,25 +28,60 @@ linux: {
 
 # Source and header files
 HEADERS += \
+    binary_image.h \
     custom_graphics_view.h \
+    dataset_generator.h \
+    degradation_dataset.h \
     gpu_filtering.h \
     image_view.h \
+    frame_cache.h \
+    frame_source.h \
+    frame_stacker.h \
+    frame_telemetry.h \
+    histogram_engine.h \
+    histogram_widget.h \
+    incremental_filter.h \
+    keyframe_index.h \
     mainwindow.h \
     controller.h \
     model.h \
+    morphology_engine.h \
+    owner_link.h \
     paint_on_img.h \
+    pipe_stream.h \
+    plane_cache.h \
     plugin_interface.h \
+    richardson_lucy.h \
+    tiled_image_item.h \
+    video_encoder.h \
     video_player.h \
     video_settings.h
 
 SOURCES += \
+    binary_image.cpp \
     custom_graphics_view.cpp \
+    dataset_generator.cpp \
+    degradation_dataset.cpp \
     image_view.cpp \
+    frame_cache.cpp \
+    frame_source.cpp \
+    frame_stacker.cpp \
+    frame_telemetry.cpp \
+    histogram_engine.cpp \
+    histogram_widget.cpp \
+    incremental_filter.cpp \
+    keyframe_index.cpp \
     main.cpp \
     mainwindow.cpp \
     model.cpp \
+    morphology_engine.cpp \
     controller.cpp \
     paint_on_img.cpp \
+    pipe_stream.cpp \
+    plane_cache.cpp \
+    richardson_lucy.cpp \
+    tiled_image_item.cpp \
+    video_encoder.cpp \
     video_player.cpp \
     video_settings.cpp
 
@@ -0,0 +1,205 @@
+#include "binary_image.h"
+
+#include <algorithm>
+#include <atomic>
+
+#include <opencv2/core/utility.hpp>
+
+BinaryImage::BinaryImage()
+    : width(0), height(0), wordsPerRow(0)
+{
+}
+
+void BinaryImage::create(int rows, int cols)
+{
+    height = rows;
+    width = cols;
+    wordsPerRow = (cols + 63) / 64;
+    words.assign(static_cast<size_t>(wordsPerRow) * rows, 0);
+}
+
+uint64_t BinaryImage::lastWordMask() const
+{
+    int used = width % 64;
+    return used == 0 ? ~uint64_t(0) : (uint64_t(1) << used) - 1;
+}
+
+bool BinaryImage::pack(const cv::Mat &image)
+{
+    if (image.empty() || image.type() != CV_8UC1) {
+        return false;
+    }
+    create(image.rows, image.cols);
+
+    std::atomic<bool> binary(true);
+    cv::parallel_for_(cv::Range(0, height), [&](const cv::Range &range) {
+        for (int y = range.start; y < range.end && binary; ++y) {
+            const uchar *src = image.ptr<uchar>(y);
+            uint64_t *dst = row(y);
+            for (int w = 0; w < wordsPerRow; ++w) {
+                int first = w * 64;
+                int count = std::min(64, width - first);
+                uint64_t word = 0;
+                uchar seen = 0; // Any bit besides 0x00 and 0xFF shows up here
+                for (int i = 0; i < count; ++i) {
+                    uchar v = src[first + i];
+                    seen |= static_cast<uchar>(v ^ (v & 0x80 ? 0xFF : 0x00));
+                    word |= static_cast<uint64_t>(v >> 7) << i;
+                }
+                if (seen) {
+                    binary = false;
+                    return;
+                }
+                dst[w] = word;
+            }
+        }
+    });
+
+    if (!binary) {
+        create(0, 0);
+    }
+    return binary;
+}
+
+void BinaryImage::unpack(cv::Mat &image) const
+{
+    image.create(height, width, CV_8UC1);
+    cv::parallel_for_(cv::Range(0, height), [&](const cv::Range &range) {
+        for (int y = range.start; y < range.end; ++y) {
+            const uint64_t *src = row(y);
+            uchar *dst = image.ptr<uchar>(y);
+            for (int x = 0; x < width; ++x) {
+                dst[x] = (src[x >> 6] >> (x & 63)) & 1 ? 255 : 0;
+            }
+        }
+    });
+}
+
+void BinaryImage::invert()
+{
+    uint64_t mask = lastWordMask();
+    for (int y = 0; y < height; ++y) {
+        uint64_t *r = row(y);
+        for (int w = 0; w < wordsPerRow; ++w) {
+            r[w] = ~r[w];
+        }
+        r[wordsPerRow - 1] &= mask; // Padding stays zero
+    }
+}
+
+// result[x] = src[x - shift] (towards higher x) or src[x + shift] (towards lower x), zero filled
+static inline uint64_t shiftedWord(const uint64_t *src, int words, int w, int wordShift, int bitShift, bool towardsHigher)
+{
+    if (towardsHigher) {
+        int s = w - wordShift;
+        uint64_t value = s >= 0 ? src[s] << bitShift : 0;
+        if (bitShift && s - 1 >= 0) {
+            value |= src[s - 1] >> (64 - bitShift);
+        }
+        return value;
+    }
+    int s = w + wordShift;
+    uint64_t value = s < words ? src[s] >> bitShift : 0;
+    if (bitShift && s + 1 < words) {
+        value |= src[s + 1] << (64 - bitShift);
+    }
+    return value;
+}
+
+// Sets pixels [from, to) of a row
+static inline void setBits(uint64_t *row, int from, int to)
+{
+    for (int x = from; x < to;) {
+        int w = x >> 6, bit = x & 63;
+        int count = std::min(64 - bit, to - x);
+        uint64_t ones = count == 64 ? ~uint64_t(0) : ((uint64_t(1) << count) - 1);
+        row[w] |= ones << bit;
+        x += count;
+    }
+}
+
+void BinaryImage::dilateRows(int radius)
+{
+    if (radius <= 0 || width == 0) {
+        return;
+    }
+    const uint64_t mask = lastWordMask();
+
+    cv::parallel_for_(cv::Range(0, height), [&](const cv::Range &range) {
+        std::vector<uint64_t> scratch(wordsPerRow);
+        for (int y = range.start; y < range.end; ++y) {
+            uint64_t *current = row(y);
+            // Covers [x - a, x + a]; adding copies shifted by c <= 2a + 1 leaves no gap.
+            // Past the border the shifted copy repeats the edge pixel, whose window
+            // contains every in-image part of the windows beyond it
+            int a = 0;
+            while (a < radius) {
+                int c = std::min(2 * a + 1, radius - a);
+                int wordShift = c / 64, bitShift = c % 64;
+                for (int w = 0; w < wordsPerRow; ++w) {
+                    scratch[w] = current[w]
+                                 | shiftedWord(current, wordsPerRow, w, wordShift, bitShift, true)
+                                 | shiftedWord(current, wordsPerRow, w, wordShift, bitShift, false);
+                }
+                if (current[0] & 1) {
+                    setBits(scratch.data(), 0, std::min(c, width));
+                }
+                if ((current[(width - 1) >> 6] >> ((width - 1) & 63)) & 1) {
+                    setBits(scratch.data(), std::max(0, width - c), width);
+                }
+                scratch[wordsPerRow - 1] &= mask;
+                std::copy(scratch.begin(), scratch.end(), current);
+                a += c;
+            }
+        }
+    });
+}
+
+void BinaryImage::dilateColumns(int radius)
+{
+    if (radius <= 0 || height == 0) {
+        return;
+    }
+    std::vector<uint64_t> scratch(words.size());
+
+    // Same widening as the rows, with whole rows as the shifted unit and the edge rows repeated
+    int a = 0;
+    while (a < radius) {
+        int c = std::min(2 * a + 1, radius - a);
+        cv::parallel_for_(cv::Range(0, height), [&](const cv::Range &range) {
+            for (int y = range.start; y < range.end; ++y) {
+                const uint64_t *center = row(y);
+                const uint64_t *above = row(std::max(0, y - c));
+                const uint64_t *below = row(std::min(height - 1, y + c));
+                uint64_t *dst = scratch.data() + static_cast<size_t>(y) * wordsPerRow;
+                for (int w = 0; w < wordsPerRow; ++w) {
+                    dst[w] = center[w] | above[w] | below[w];
+                }
+            }
+        });
+        words.swap(scratch);
+        a += c;
+    }
+}
+
+void BinaryImage::dilate(int radiusX, int radiusY, BinaryImage &result) const
+{
+    if (&result != this) {
+        result = *this;
+    }
+    result.dilateRows(std::max(0, radiusX));
+    result.dilateColumns(std::max(0, radiusY));
+}
+
+void BinaryImage::erode(int radiusX, int radiusY, BinaryImage &result) const
+{
+    // Erosion is dilation of the complement; with zero padding outside the image that
+    // treats the outside as foreground, as OpenCV's erode does
+    if (&result != this) {
+        result = *this;
+    }
+    result.invert();
+    result.dilateRows(std::max(0, radiusX));
+    result.dilateColumns(std::max(0, radiusY));
+    result.invert();
+}
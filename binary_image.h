@@ -0,0 +1,48 @@
+#ifndef BINARY_IMAGE_H
+#define BINARY_IMAGE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+// Binary image with one bit per pixel, 64 pixels per word. Bit x % 64 of word x / 64
+// is pixel x; bits past the last column are always zero. Erosion and dilation with
+// a rectangular element run as separable row and column passes of whole-word
+// shifts and ORs, each widened by roughly 3x per step, so a pass costs O(log r) word
+// operations per 64 pixels. Pixels outside the image never contribute, which matches
+// OpenCV's default border for both operations.
+class BinaryImage
+{
+public:
+    BinaryImage();
+
+    // Packs an 8-bit single-channel image whose pixels are all 0 or 255; false otherwise
+    bool pack(const cv::Mat &image);
+    void unpack(cv::Mat &image) const; // CV_8UC1, 0 or 255
+
+    void erode(int radiusX, int radiusY, BinaryImage &result) const;  // (2rx+1) x (2ry+1) rectangle
+    void dilate(int radiusX, int radiusY, BinaryImage &result) const;
+
+    int rows() const { return height; }
+    int cols() const { return width; }
+    bool empty() const { return width == 0 || height == 0; }
+
+private:
+    void create(int rows, int cols);
+    uint64_t *row(int y) { return words.data() + static_cast<size_t>(y) * wordsPerRow; }
+    const uint64_t *row(int y) const { return words.data() + static_cast<size_t>(y) * wordsPerRow; }
+    uint64_t lastWordMask() const;
+    void invert();
+
+    void dilateRows(int radius);
+    void dilateColumns(int radius);
+
+    int width;
+    int height;
+    int wordsPerRow;
+    std::vector<uint64_t> words;
+};
+
+#endif // BINARY_IMAGE_H
@@ -1,6 +1,10 @@
 #include "controller.h"
 
-
+// Pixels each instrument reads around an ROI (its kernel radius), so the ROI edge matches a full run
+static const int SOBEL_HALO = 1;          // 3x3
+static const int BLUR_HALO = 7;           // 15x15 Gaussian
+static const int DEBLUR_HALO = 50 * 8;    // Up to 50 iterations of a 9x9 blur and its transpose
+static const int VECTOR_FILTER_HALO = 2;  // Same halo as the incremental video filter
 
 
 ImagingInstrumentsController::ImagingInstrumentsController(QObject *parent)
@@ -53,7 +57,7 @@ ImagingInstrumentsController::~ImagingInstrumentsController() {
 
 
 void ImagingInstrumentsController::switchToDragDropView() {
-    model->inputImage.release();
+    model->setInputImage(cv::Mat()); // Also drops the planes derived from it
     model->noisyImage.release();
 
     if (image_view) {
@@ -91,6 +95,14 @@ bool ImagingInstrumentsController::checkCUDA() {
     return true;
 }
 
+bool ImagingInstrumentsController::isCudaAvailable() {
+    // The device query is cached; per-frame callers should not hit the driver every time
+    if (cudaState < 0) {
+        cudaState = checkCUDA() ? 1 : 0;
+    }
+    return cudaState == 1;
+}
+
 void ImagingInstrumentsController::onFileDropped(const QString &filePath) {
     QStringList imageExtensions = {".png", ".jpg", ".jpeg", ".bmp", ".gif", ".tiff"};
     QString fileExtension = QFileInfo(filePath).suffix().toLower();
@@ -108,23 +120,27 @@ void ImagingInstrumentsController::onFileDropped(const QString &filePath) {
 }
 
 void ImagingInstrumentsController::onImageDropped(const QImage &image) {
-    image_view->scene->clear();
+    image_view->clearImage(); // A new image starts from a fitted view, even at the same size
+    model->clearRoi();
 
-    // Convert the image to RGB888 format for processing
-    QImage originalImage = image.convertToFormat(QImage::Format_RGB888);
+    // Stored as BGR, the order OpenCV and the plugins expect, or as one channel for
+    // grayscale files; the view shows either as is
+    bool gray = image.isGrayscale();
+    QImage originalImage = image.convertToFormat(gray ? QImage::Format_Grayscale8 : QImage::Format_BGR888);
 
     // Convert to cv::Mat for processing
-    cv::Mat matImage(originalImage.height(), originalImage.width(), CV_8UC3, originalImage.bits(), originalImage.bytesPerLine());
+    cv::Mat matImage(originalImage.height(), originalImage.width(), gray ? CV_8UC1 : CV_8UC3,
+                     const_cast<uchar*>(originalImage.constBits()), originalImage.bytesPerLine());
 
     // Update the model with the original image
-    model->inputImage = matImage.clone();
+    model->setInputImage(matImage.clone());
     model->setOriginalInputImage(matImage);
 
     main_window->close();
 
     // Apply theme and display the original image without resizing
     image_view->applyTheme(currentTheme);
-    image_view->displayImage(originalImage);
+    image_view->displayImage(toQImage(model->inputImage));
 
     // Set the scene rect to the image size and fit it in the view
     image_view->scene->setSceneRect(0, 0, originalImage.width(), originalImage.height());
@@ -167,6 +183,20 @@ void ImagingInstrumentsController::onVideoDropped(const QString &videoPath) {
             setSaveEnabled(settingsDialog.isSaveEnabled());
             logMsg = "Controller save state after update: " + QString::number(isSaveEnabled());
             logMessage(logMsg, STATUS_MSG);
+
+            setOutputPath(outputPath);
+            setVideoFormat(selectedFormat);
+            setEncoderThreads(settingsDialog.getEncoderThreads());
+
+            setIncrementalFilteringEnabled(settingsDialog.isIncrementalFilteringEnabled());
+            setChangeThreshold(settingsDialog.getChangeThreshold());
+            setRefreshInterval(settingsDialog.getRefreshInterval());
+
+            setStackingEnabled(settingsDialog.isStackingEnabled());
+            setStackingMode(settingsDialog.getStackingMode());
+            setStackingWindow(settingsDialog.getStackingWindow());
+
+            setVideoRoi(settingsDialog.getRoi());
         }
     } else {
         QMessageBox::warning(nullptr, "File Error", "The video file does not exist.");
@@ -186,13 +216,13 @@ void ImagingInstrumentsController::loadImage(const QString &fileName)
         return; // Early return if image loading fails
     }
 
-    model->inputImage = image;
+    model->setInputImage(image);
 
     // Log successful image loading
     QString logMsg = "Image loaded successfully from file: " + fileName;
     logMessage(logMsg, STATUS_MSG);
 
-    QImage qImage(image.data, image.cols, image.rows, image.step, QImage::Format_RGB888);
+    QImage qImage = toQImage(image);
 }
 
 void ImagingInstrumentsController::saveImage(const QImage &image)
@@ -217,6 +247,13 @@ void ImagingInstrumentsController::saveImage(const QImage &image)
 void ImagingInstrumentsController::enterImpulseNoiseMode()
 {
     impulseNoiseMode = true;
+
+    // Start from a private output buffer and a fresh mask for the current image
+    model->noisyImage.release();
+    if (noisePluginObject) {
+        QMetaObject::invokeMethod(noisePluginObject, "resetNoiseCache");
+    }
+
     QString logMsg = "Impulse Noise Mode activated with noise_density set to: " + QString::number(noise_density);
     logMessage(logMsg, STATUS_MSG); // Log the activation of impulse noise mode
 }
@@ -228,7 +265,7 @@ void ImagingInstrumentsController::exitImpulseNoiseMode()
     logMessage(logMsg, STATUS_MSG);
 
     if (!model->noisyImage.empty()) {
-        model->inputImage = model->noisyImage.clone();
+        model->setInputImage(model->noisyImage.clone());
         logMsg = "Current image updated with the noisy image.";
         logMessage(logMsg, STATUS_MSG); // Log the image update
     } else {
@@ -257,6 +294,7 @@ void ImagingInstrumentsController::applyImpulseNoise()
         return;
     }
 
+    model->promoteToColor(); // Gray images stay gray until an instrument needs color
     if (model->inputImage.type() != CV_8UC3) {
         logMessage("Input image is not an unsigned 8-bit color image. Converting...", STATUS_MSG); // Log the conversion attempt
 
@@ -270,42 +308,68 @@ void ImagingInstrumentsController::applyImpulseNoise()
         }
     }
 
+    if (!loadNoisePlugin()) {
+        return;
+    }
+
+    // Fixed seeds make the noise bit-reproducible for benchmarks; older plugin builds ignore the property
+    if (noiseSeed != 0) {
+        noisePluginObject->setProperty("seed", QVariant::fromValue(noiseSeed));
+    }
+
+    // The plugin updates model->noisyImage in place when it gets the same buffer back,
+    // touching only the pixels whose noise threshold lies between the old and new density
+    logMessage("Executing ImpulseNoise processing...", STATUS_MSG); // Log the processing attempt
+    noisePlugin->processImage(model->inputImage, model->noisyImage, noise_density);
+
+    cv::Mat &noisy = model->noisyImage;
+    if (noisy.empty() || noisy.type() != CV_8UC3) {
+        logMessage("Failed to create QImage from processed output.", ERROR_MSG); // Log the error
+        QMessageBox::warning(image_view, tr("Warning"), tr("Failed to create QImage from the processed image."));
+        return;
+    }
+
+    // Plugin builds without dirty-rect reporting get a full update
+    QVariant dirtyProperty = noisePluginObject->property("dirtyRect");
+    QRect dirty = dirtyProperty.isValid() ? dirtyProperty.toRect() : QRect(0, 0, noisy.cols, noisy.rows);
+
+    // Wraps the noisy buffer without copying; ImageView only reads the dirty region
+    QImage noisyView(noisy.data, noisy.cols, noisy.rows, static_cast<int>(noisy.step), QImage::Format_BGR888);
+    logMessage("Noise density " + QString::number(noise_density) + ", updated region " +
+                   QString("%1x%2").arg(dirty.width()).arg(dirty.height()), STATUS_MSG);
+    image_view->updateImageRegion(noisyView, dirty);
+}
+
+bool ImagingInstrumentsController::loadNoisePlugin()
+{
+    if (noisePlugin) {
+        return true;
+    }
+
     QString pluginPath = QCoreApplication::applicationDirPath() + "/libs/impulse_noise2.dll";
     //QString pluginPath = QCoreApplication::applicationDirPath() + "/libs_arm64/release/libimpulse_noise2.so";
     logMessage("Plugin Path: " + pluginPath, STATUS_MSG); // Log the plugin path
 
     QPluginLoader pluginLoader(pluginPath);
-    if (!pluginLoader.instance()) {
+    QObject *instance = pluginLoader.instance();
+    if (!instance) {
         logMessage("Failed to load plugin: " + pluginLoader.errorString(), ERROR_MSG); // Log the error
         QMessageBox::warning(image_view, tr("Warning"), tr("Failed to load the impulse noise plugin."));
-        return;
+        return false;
     }
 
-    PluginInterfaceNoise *plugin = dynamic_cast<PluginInterfaceNoise*>(pluginLoader.instance());
+    PluginInterfaceNoise *plugin = dynamic_cast<PluginInterfaceNoise*>(instance);
     if (!plugin) {
         logMessage("Plugin does not implement PluginInterfaceNoise", ERROR_MSG); // Log the error
         QMessageBox::warning(image_view, tr("Warning"), tr("The plugin does not implement PluginInterfaceNoise."));
-        return;
-    }
-
-    cv::Mat outputImage1;
-    logMessage("Executing ImpulseNoise processing...", STATUS_MSG); // Log the processing attempt
-    plugin->processImage(model->inputImage, outputImage1, noise_density);
-
-    QImage currentImage(outputImage1.data, outputImage1.cols, outputImage1.rows, outputImage1.step, QImage::Format_RGB888);
-    QImage currentImageCopy = currentImage.copy();
-
-    if (currentImageCopy.isNull()) {
-        logMessage("Failed to create QImage from processed output.", ERROR_MSG); // Log the error
-        QMessageBox::warning(image_view, tr("Warning"), tr("Failed to create QImage from the processed image."));
-        return;
+        return false;
     }
 
-    logMessage("Current image dimensions: " + QString::number(currentImageCopy.width()) + "x" + QString::number(currentImageCopy.height()) +
-                   " Type: " + QString::number(currentImageCopy.format()), STATUS_MSG); // Log dimensions
-
-    model->noisyImage = outputImage1.clone();
-    image_view->displayImage(currentImageCopy);
+    // The library stays loaded after the loader goes out of scope, so the instance can be kept
+    instance->setProperty("monotone", true);
+    noisePlugin = plugin;
+    noisePluginObject = instance;
+    return true;
 }
 
 
@@ -330,6 +394,7 @@ void ImagingInstrumentsController::applyVectorFilter()
         return;
     }
 
+    model->promoteToColor();
     if (model->inputImage.type() != CV_8UC3) {
         logMessage("Input image is not an unsigned 8-bit color image. Converting",STATUS_MSG);  // Log message
         if (model->inputImage.type() == CV_32FC3) {
@@ -341,89 +406,35 @@ void ImagingInstrumentsController::applyVectorFilter()
         }
     }
 
-    size_t Y = model->inputImage.rows;
-    size_t X = model->inputImage.cols;
-
-    cv::Mat img_noisy_float;
-    cv::Mat img_clean_float;
-
     auto start = std::chrono::high_resolution_clock::now();
-    if (checkCUDA()) {
-        logMessage("GPU filtering.",STATUS_MSG);
+    bool useGpu = isCudaAvailable();
+    logMessage(useGpu ? "GPU filtering." : "CPU Filtering.", STATUS_MSG);
 
-        model->inputImage.convertTo(img_noisy_float, CV_32FC3);
-
-        img_clean_float = cv::Mat(Y, X, CV_32FC3);
-
-        try {
-            // Call the CUDA kernel to filter the image
-            run_gpu_filter(img_clean_float.ptr<float>(), img_noisy_float.ptr<float>(), Y, X); // Pass the output pointer
-        } catch (const std::exception &e) {
-            logMessage("CUDA filter execution failed: " + QString::fromStdString(e.what()),ERROR_MSG);  // Log message
-            QMessageBox::warning(image_view, tr("Warning"), tr("CUDA filter execution failed."));
-            return;
-        }
-
-        img_clean_float.convertTo(model->outputImage, CV_8UC3);  // Store the result in model->outputImage
-    } else {
-        //CPU EXEC
-        logMessage("CPU Filtering.",STATUS_MSG);
-
-        ImageFiltering filter;
-
-        model->outputImage = model->inputImage.clone(); // Initialize outputImage
-        try {
-            // Call the DLL function to filter the image
-            filter.run_filter(model->inputImage, model->outputImage); // Using the function from your DLL
-        } catch (const std::exception &e) {
-            logMessage("DLL filter execution failed: " + QString::fromStdString(e.what()), ERROR_MSG);  // Log message
-            QMessageBox::warning(image_view, tr("Warning"), tr("DLL filter execution failed."));
-            return;
-        }
-    }
-
-    if (model->outputImage.empty()) {
-        logMessage("Output image is empty!",ERROR_MSG);  // Log message
+    model->beginRoi(VECTOR_FILTER_HALO);
+    if (!model->runVectorFilter(model->inputImage, model->outputImage, useGpu)) {
+        model->endRoi(cv::Mat());
+        logMessage("Vector filter execution failed.", ERROR_MSG);  // Log message
         QMessageBox::warning(image_view, tr("Warning"), tr("Failed to process the image."));
         return;
     }
-    if (model->outputImage.type() != CV_8UC3) {
-        logMessage("Output image is not CV_8UC3. Converting",STATUS_MSG);  // Log message
-        if (model->outputImage.type() == CV_32FC3) {
-            model->outputImage.convertTo(model->outputImage, CV_8UC3);  // Convert float to 8-bit color
-        } else {
-            logMessage("Unsupported output image format!", ERROR_MSG);  // Log message
-            QMessageBox::warning(image_view, tr("Warning"), tr("Output image has an unsupported format."));
-            return;
-        }
-    }
+
     auto end = std::chrono::high_resolution_clock::now(); // End timing
     std::chrono::duration<double> elapsed = end - start;
 
-    if (checkCUDA()) {
+    if (useGpu) {
         logMessage("Time taken for GPU processing: " + QString::number(elapsed.count()) + " seconds", STATUS_MSG);  // Log message
     } else {
         logMessage("Time taken for CPU processing: " + QString::number(elapsed.count()) + " seconds", STATUS_MSG);  // Log message
     }
 
-    QImage currentImage(model->outputImage.data, model->outputImage.cols, model->outputImage.rows, model->outputImage.step, QImage::Format_RGB888);
-    QImage currentImageCopy = currentImage.copy();
-
-    if (currentImageCopy.isNull()) {
-        logMessage("Failed to create QImage from processed output", ERROR_MSG);  // Log message
+    // Store the filtered image in the model for further processing and display it
+    if (!showResult(model->outputImage)) {
         QMessageBox::warning(image_view, tr("Warning"), tr("Failed to create QImage from the processed image."));
-        return;
     }
-
-    // Store the filtered image in the model for further processing
-    model->inputImage = model->outputImage.clone(); // Update inputImage with the result
-
-    // Display the image
-    image_view->displayImage(currentImageCopy);
 }
 
 
-void ImagingInstrumentsController::applyColorEnhancement() {
+void ImagingInstrumentsController::applyColorEnhancement(const std::string &method) {
     // Log start of function
     logMessage("Applying color enhancement",STATUS_MSG);
 
@@ -434,6 +445,7 @@ void ImagingInstrumentsController::applyColorEnhancement() {
         return;
     }
 
+    model->promoteToColor();
     if (model->inputImage.type() != CV_8UC3) {
         logMessage("Input image is not an unsigned 8-bit color image. Converting", STATUS_MSG);
         if (model->inputImage.type() == CV_32FC3) {
@@ -450,42 +462,61 @@ void ImagingInstrumentsController::applyColorEnhancement() {
     size_t X = model->inputImage.cols;
     cv::Mat outputImage;
 
-    QString pluginPath = QCoreApplication::applicationDirPath() + "/libs/color_enhancement.dll";
-    logMessage("Plugin Path: " + pluginPath, STATUS_MSG);
-
-    QPluginLoader pluginLoader(pluginPath);
-    if (!pluginLoader.instance()) {
-        logMessage("Failed to load plugin: " + pluginLoader.errorString(),ERROR_MSG);
-        QMessageBox::warning(image_view, tr("Warning"), tr("Failed to load the vector filter plugin."));
+    if (!loadColorEnhancementPlugin()) {
         return;
     }
 
-    PluginInterfaceColorEnhancement *plugin = dynamic_cast<PluginInterfaceColorEnhancement*>(pluginLoader.instance());
-    if (!plugin) {
-        logMessage("Plugin does not implement PluginInterfaceFiltering",ERROR_MSG);
-        QMessageBox::warning(image_view, tr("Warning"), tr("The plugin does not implement PluginInterfaceFiltering."));
+    // Histogram methods take their statistics from the ROI itself, so there is no halo
+    model->beginRoi(0);
+    outputImage = model->inputImage.clone();
+
+    colorEnhancementPlugin->processImage(model->inputImage, outputImage, method);
+    logMessage("Image processed using method: " + QString::fromStdString(method),STATUS_MSG);
+
+    if (!showResult(outputImage)) {
+        QMessageBox::warning(image_view, tr("Warning"), tr("Failed to create QImage from the processed image."));
         return;
     }
+    logMessage("Color enhancement applied successfully and image displayed.", STATUS_MSG);
+}
 
-    outputImage = model->inputImage.clone();
 
-    plugin->processImage(model->inputImage, outputImage, "histAdaptive");
-    logMessage("Image processed using method: histAdaptive",STATUS_MSG);
+bool ImagingInstrumentsController::loadColorEnhancementPlugin()
+{
+    if (colorEnhancementPlugin) {
+        return true;
+    }
 
-    QImage currentImage(outputImage.data, outputImage.cols, outputImage.rows, outputImage.step, QImage::Format_RGB888);
-    QImage currentImageCopy = currentImage.copy();
+    QString pluginPath = QCoreApplication::applicationDirPath() + "/libs/color_enhancement.dll";
+    logMessage("Plugin Path: " + pluginPath, STATUS_MSG);
 
-    if (currentImageCopy.isNull()) {
-        logMessage("Failed to create QImage from processed output",ERROR_MSG);
+    QPluginLoader pluginLoader(pluginPath);
+    QObject *instance = pluginLoader.instance();
+    if (!instance) {
+        logMessage("Failed to load plugin: " + pluginLoader.errorString(),ERROR_MSG);
+        QMessageBox::warning(image_view, tr("Warning"), tr("Failed to load the color enhancement plugin."));
+        return false;
+    }
 
-        QMessageBox::warning(image_view, tr("Warning"), tr("Failed to create QImage from the processed image."));
-        return;
+    PluginInterfaceColorEnhancement *plugin = dynamic_cast<PluginInterfaceColorEnhancement*>(instance);
+    if (!plugin) {
+        logMessage("Plugin does not implement PluginInterfaceColorEnhancement",ERROR_MSG);
+        QMessageBox::warning(image_view, tr("Warning"), tr("The plugin does not implement PluginInterfaceColorEnhancement."));
+        return false;
     }
 
-    model->inputImage = outputImage.clone();
+    // Kept loaded: the video CLAHE holds its tile LUTs between frames
+    colorEnhancementPlugin = plugin;
+    colorEnhancementObject = instance;
+    return true;
+}
 
-    image_view->displayImage(currentImageCopy);
-    logMessage("Color enhancement applied successfully and image displayed.", STATUS_MSG);
+void ImagingInstrumentsController::resetColorEnhancementState()
+{
+    // Older plugin builds have no temporal state to reset
+    if (colorEnhancementObject) {
+        QMetaObject::invokeMethod(colorEnhancementObject, "resetTemporalState");
+    }
 }
 
 
@@ -493,17 +524,11 @@ void ImagingInstrumentsController::applySobelFilter()
 {
     if (model) {
         logMessage("Applying Sobel Edge Detection...", STATUS_MSG); // Log the start of Sobel filter application
+        model->beginRoi(SOBEL_HALO);
         model->applySobelEdgeDetection();
 
         if (image_view) {
-            cv::Mat rgbImage;
-            cv::cvtColor(model->outputImage, rgbImage, cv::COLOR_BGR2RGB);
-            model->inputImage = rgbImage.clone();
-
-            QImage img = QImage(rgbImage.data, rgbImage.cols, rgbImage.rows, rgbImage.step[0], QImage::Format_RGB888);
-            img = img.copy();
-
-            image_view->displayImage(img);
+            showResult(model->outputImage);
             logMessage("Sobel filter applied and image displayed.", STATUS_MSG); // Log successful application
         }
     } else {
@@ -515,17 +540,11 @@ void ImagingInstrumentsController::applyBlur()
 {
     if (model) {
         logMessage("Applying Blur...", STATUS_MSG); // Log the start of blur application
+        model->beginRoi(BLUR_HALO);
         model->applyBlur();
 
         if (image_view) {
-            cv::Mat rgbImage;
-            cv::cvtColor(model->outputImage, rgbImage, cv::COLOR_BGR2RGB);
-            model->inputImage = rgbImage.clone();
-
-            QImage img = QImage(rgbImage.data, rgbImage.cols, rgbImage.rows, rgbImage.step[0], QImage::Format_RGB888);
-            img = img.copy();
-
-            image_view->displayImage(img);
+            showResult(model->outputImage);
             logMessage("Blur applied and image displayed.", STATUS_MSG); // Log successful application
         }
     } else {
@@ -537,17 +556,11 @@ void ImagingInstrumentsController::applyDeBlur()
 {
     if (model) {
         logMessage("Applying De-Blur...", STATUS_MSG); // Log the start of de-blur application
+        model->beginRoi(DEBLUR_HALO);
         model->applyDeBlur();
 
         if (image_view) {
-            cv::Mat rgbImage;
-            cv::cvtColor(model->outputImage, rgbImage, cv::COLOR_BGR2RGB);
-            model->inputImage = rgbImage.clone();
-
-            QImage img = QImage(rgbImage.data, rgbImage.cols, rgbImage.rows, rgbImage.step[0], QImage::Format_RGB888);
-            img = img.copy();
-
-            image_view->displayImage(img);
+            showResult(model->outputImage);
             logMessage("De-Blur applied and image displayed.", STATUS_MSG); // Log successful application
         }
     } else {
@@ -559,20 +572,11 @@ void ImagingInstrumentsController::applyBinarization(int threshold)
 {
     if (model) {
         logMessage("Applying Binarization with threshold: " + QString::number(threshold), STATUS_MSG); // Log the start of binarization
+        model->beginRoi(0);
         model->applyBinarization(threshold);
 
         if (image_view) {
-            cv::Mat binaryImage = model->outputImage;
-
-            cv::Mat rgbImage;
-            cv::cvtColor(binaryImage, rgbImage, cv::COLOR_BGR2RGB);
-
-            model->inputImage = rgbImage.clone();
-
-            QImage img = QImage(rgbImage.data, rgbImage.cols, rgbImage.rows, rgbImage.step[0], QImage::Format_RGB888);
-            img = img.copy();
-
-            image_view->displayImage(img);
+            showResult(model->outputImage);
             logMessage("Binarization applied and image displayed.", STATUS_MSG); // Log successful application
         }
     } else {
@@ -584,19 +588,11 @@ void ImagingInstrumentsController::applyErosion(int erosionSize)
 {
     if (model) {
         logMessage("Applying Erosion with size: " + QString::number(erosionSize), STATUS_MSG); // Log the start of erosion
+        model->beginRoi(erosionSize);
         model->applyErosion(erosionSize);
 
         if (image_view) {
-            cv::Mat erodedImage = model->outputImage;
-
-            cv::Mat rgbImage;
-            cv::cvtColor(erodedImage, rgbImage, cv::COLOR_BGR2RGB);
-
-            model->inputImage = rgbImage.clone();
-
-            QImage img = QImage(rgbImage.data, rgbImage.cols, rgbImage.rows, rgbImage.step[0], QImage::Format_RGB888);
-            img = img.copy();
-            image_view->displayImage(img);
+            showResult(model->outputImage);
             logMessage("Erosion applied and image displayed.", STATUS_MSG); // Log successful application
         }
     } else {
@@ -608,19 +604,11 @@ void ImagingInstrumentsController::applyDilation(int dilationSize)
 {
     if (model) {
         logMessage("Applying Dilation with size: " + QString::number(dilationSize), STATUS_MSG); // Log the start of dilation
+        model->beginRoi(dilationSize);
         model->applyDilation(dilationSize);
 
         if (image_view) {
-            cv::Mat dilatedImage = model->outputImage;
-
-            cv::Mat rgbImage;
-            cv::cvtColor(dilatedImage, rgbImage, cv::COLOR_BGR2RGB);
-
-            model->inputImage = rgbImage.clone();
-
-            QImage img = QImage(rgbImage.data, rgbImage.cols, rgbImage.rows, rgbImage.step[0], QImage::Format_RGB888);
-            img = img.copy();
-            image_view->displayImage(img);
+            showResult(model->outputImage);
             logMessage("Dilation applied and image displayed.", STATUS_MSG); // Log successful application
         }
     } else {
@@ -632,18 +620,11 @@ void ImagingInstrumentsController::applyOpening(int openingSize)
 {
     if (model) {
         logMessage("Applying Opening with size: " + QString::number(openingSize), STATUS_MSG); // Log the start of opening
+        model->beginRoi(2 * openingSize);
         model->applyOpening(openingSize);
 
         if (image_view) {
-            cv::Mat openedImage = model->outputImage;
-
-            cv::Mat rgbImage;
-            cv::cvtColor(openedImage, rgbImage, cv::COLOR_BGR2RGB);
-
-            model->inputImage = rgbImage.clone();
-            QImage img = QImage(rgbImage.data, rgbImage.cols, rgbImage.rows, rgbImage.step[0], QImage::Format_RGB888);
-            img = img.copy();
-            image_view->displayImage(img);
+            showResult(model->outputImage);
             logMessage("Opening applied and image displayed.", STATUS_MSG); // Log successful application
         }
     } else {
@@ -655,19 +636,11 @@ void ImagingInstrumentsController::applyClosing(int closingSize)
 {
     if (model) {
         logMessage("Applying Closing with size: " + QString::number(closingSize), STATUS_MSG); // Log the start of closing
+        model->beginRoi(2 * closingSize);
         model->applyClosing(closingSize);
 
         if (image_view) {
-            cv::Mat closedImage = model->outputImage;
-
-            cv::Mat rgbImage;
-            cv::cvtColor(closedImage, rgbImage, cv::COLOR_BGR2RGB);
-
-            model->inputImage = rgbImage.clone();
-
-            QImage img = QImage(rgbImage.data, rgbImage.cols, rgbImage.rows, rgbImage.step[0], QImage::Format_RGB888);
-            img = img.copy();
-            image_view->displayImage(img);
+            showResult(model->outputImage);
             logMessage("Closing applied and image displayed.", STATUS_MSG); // Log successful application
         }
     } else {
@@ -677,6 +650,65 @@ void ImagingInstrumentsController::applyClosing(int closingSize)
 
 
 
+QImage ImagingInstrumentsController::toQImage(const cv::Mat &image, bool keepAlive)
+{
+    QImage::Format format;
+    switch (image.type()) {
+    case CV_8UC1: format = QImage::Format_Grayscale8; break;
+    case CV_8UC3: format = QImage::Format_BGR888; break;
+    case CV_8UC4: format = QImage::Format_ARGB32; break; // BGRA bytes
+    default: return QImage();
+    }
+
+    if (!keepAlive) {
+        return QImage(static_cast<const uchar*>(image.data), image.cols, image.rows, static_cast<qsizetype>(image.step[0]), format);
+    }
+
+    // The QImage holds a reference to the Mat and is read-only, so writes through it detach
+    cv::Mat *owner = new cv::Mat(image);
+    return QImage(static_cast<const uchar*>(owner->data), owner->cols, owner->rows, static_cast<qsizetype>(owner->step[0]),
+                  format, [](void *info) { delete static_cast<cv::Mat*>(info); }, owner);
+}
+
+bool ImagingInstrumentsController::showResult(const cv::Mat &result)
+{
+    // Single-channel results stay single channel and are shown as Grayscale8
+    cv::Rect pasted;
+    cv::Mat composed = model->endRoi(result, &pasted);
+    if (pasted.area() > 0) {
+        // Only the ROI changed. The view copies that region out of the model's buffer and
+        // keeps no reference to it, so the next ROI result is pasted in place again.
+        model->setInputImage(composed);
+        image_view->updateImageRegion(toQImage(composed, false), QRect(pasted.x, pasted.y, pasted.width, pasted.height));
+        return true;
+    }
+    if (composed.data == result.data) {
+        composed = composed.clone(); // The instrument may write into its output buffer again
+    }
+
+    QImage display = toQImage(composed);
+    if (display.isNull()) {
+        logMessage("Failed to create QImage from processed output", ERROR_MSG);
+        return false;
+    }
+    model->setInputImage(composed);
+    image_view->displayImage(display);
+    return true;
+}
+
+void ImagingInstrumentsController::setRoi(const QRect &rect)
+{
+    model->setRoi(cv::Rect(rect.x(), rect.y(), rect.width(), rect.height()));
+    logMessage(QString("Region of interest %1x%2 at (%3, %4)")
+                   .arg(rect.width()).arg(rect.height()).arg(rect.x()).arg(rect.y()), STATUS_MSG);
+}
+
+void ImagingInstrumentsController::clearRoi()
+{
+    model->clearRoi();
+    logMessage("Region of interest cleared, instruments process the whole image", STATUS_MSG);
+}
+
 void ImagingInstrumentsController::logMessage(const QString &message, MessageType type)
 {
     QString documentsPath = QStandardPaths::writableLocation(QStandardPaths::DocumentsLocation);
@@ -744,7 +776,7 @@ void ImagingInstrumentsController::exitDrawingMode() {
     logMessage(logMsg, STATUS_MSG); // Log deactivation of drawing mode
 
     if (!model->noisyImage.empty()) {
-        model->inputImage = model->noisyImage.clone(); // Update the model with the noisy image
+        model->setInputImage(model->noisyImage.clone()); // Update the model with the noisy image
         logMsg = "Current image updated with Doodles";
         logMessage(logMsg, STATUS_MSG); // Log the image update
     } else {
@@ -802,6 +834,110 @@ bool ImagingInstrumentsController::isSaveEnabled() const {
     return saveEnabled;
 }
 
+void ImagingInstrumentsController::setIncrementalFilteringEnabled(bool enabled) {
+    incrementalFilteringEnabled = enabled;
+    logMessage("Incremental filtering set to: " + QString(enabled ? "enabled" : "disabled"), STATUS_MSG);
+}
+
+void ImagingInstrumentsController::setChangeThreshold(double threshold) {
+    changeThreshold = threshold;
+    logMessage("Incremental change threshold set to: " + QString::number(threshold), STATUS_MSG);
+}
+
+void ImagingInstrumentsController::setRefreshInterval(int frames) {
+    refreshInterval = frames;
+    logMessage("Incremental full refresh every " + QString::number(frames) + " frames", STATUS_MSG);
+}
+
+bool ImagingInstrumentsController::isIncrementalFilteringEnabled() const {
+    return incrementalFilteringEnabled;
+}
+
+double ImagingInstrumentsController::getChangeThreshold() const {
+    return changeThreshold;
+}
+
+int ImagingInstrumentsController::getRefreshInterval() const {
+    return refreshInterval;
+}
+
+void ImagingInstrumentsController::setNoiseSeed(quint64 seed) {
+    noiseSeed = seed;
+    logMessage("Noise seed set to: " + (seed != 0 ? QString::number(seed) : QString("plugin default")), STATUS_MSG);
+}
+
+quint64 ImagingInstrumentsController::getNoiseSeed() const {
+    return noiseSeed;
+}
+
+void ImagingInstrumentsController::setStackingEnabled(bool enabled) {
+    stackingEnabled = enabled;
+    logMessage("Temporal stacking set to: " + QString(enabled ? "enabled" : "disabled"), STATUS_MSG);
+}
+
+void ImagingInstrumentsController::setStackingMode(const QString &mode) {
+    stackingMode = mode;
+    logMessage("Temporal stacking mode set to: " + mode, STATUS_MSG);
+}
+
+void ImagingInstrumentsController::setStackingWindow(int frames) {
+    stackingWindow = frames;
+    logMessage("Temporal stacking window set to: " + QString::number(frames) + " frames", STATUS_MSG);
+}
+
+bool ImagingInstrumentsController::isStackingEnabled() const {
+    return stackingEnabled;
+}
+
+QString ImagingInstrumentsController::getStackingMode() const {
+    return stackingMode;
+}
+
+int ImagingInstrumentsController::getStackingWindow() const {
+    return stackingWindow;
+}
+
+void ImagingInstrumentsController::setVideoRoi(const QRect &rect) {
+    videoRoi = rect;
+    if (rect.isNull()) {
+        logMessage("Video region of interest cleared, instruments process full frames", STATUS_MSG);
+    } else {
+        logMessage(QString("Video region of interest %1x%2 at (%3, %4)")
+                       .arg(rect.width()).arg(rect.height()).arg(rect.x()).arg(rect.y()), STATUS_MSG);
+    }
+}
+
+QRect ImagingInstrumentsController::getVideoRoi() const {
+    return videoRoi;
+}
+
+void ImagingInstrumentsController::setOutputPath(const QString &path) {
+    outputPath = path;
+    logMessage("Video output path set to: " + path, STATUS_MSG);
+}
+
+void ImagingInstrumentsController::setVideoFormat(const QString &format) {
+    videoFormat = format;
+    logMessage("Video format set to: " + format, STATUS_MSG);
+}
+
+void ImagingInstrumentsController::setEncoderThreads(int threads) {
+    encoderThreads = threads;
+    logMessage("Encoder threads set to: " + (threads > 0 ? QString::number(threads) : QString("auto")), STATUS_MSG);
+}
+
+QString ImagingInstrumentsController::getOutputPath() const {
+    return outputPath;
+}
+
+QString ImagingInstrumentsController::getVideoFormat() const {
+    return videoFormat;
+}
+
+int ImagingInstrumentsController::getEncoderThreads() const {
+    return encoderThreads;
+}
+
 
 
 void ImagingInstrumentsController::loadPlugins(QMenu *customInstrumentMenu)
@@ -882,27 +1018,32 @@ void ImagingInstrumentsController::applyCustomInstrument(PluginInstrument* instr
             return;  // Exit if no valid image is provided
         }
 
+        // Plugins are written for BGR input
+        model->promoteToColor();
+
+        // With an ROI the plugin gets a view of the ROI plus the halo it declares, and
+        // "roi" tells it which part of that view is kept
+        QMap<QString, QVariant> parameters;
+        if (model->hasRoi()) {
+            parameters = instrument->defaultParameters();
+            if (model->beginRoi(parameters.value("halo", 0).toInt())) {
+                cv::Rect inner = model->roiInView();
+                parameters.insert("roi", QRect(inner.x, inner.y, inner.width, inner.height));
+            }
+        }
+
         // Apply the custom instrument's image processing function
-        instrument->processImage(model->inputImage, model->outputImage);
+        instrument->processImage(model->inputImage, model->outputImage, parameters);
 
         // Check if outputImage is valid after processing
         if (model->outputImage.empty()) {
+            model->endRoi(cv::Mat());
             qWarning() << "Output image is empty after plugin processing!";
             return;
         }
 
-        // Convert the output image from BGR to RGB for display
-        cv::Mat rgbImage;
-        cv::cvtColor(model->outputImage, rgbImage, cv::COLOR_BGR2RGB);
-        model->inputImage = rgbImage.clone();  // Update inputImage with processed result
-
-        // Convert the processed image to QImage for display in UI
-        QImage img = QImage(rgbImage.data, rgbImage.cols, rgbImage.rows, rgbImage.step[0], QImage::Format_RGB888);
-        img = img.copy();  // Ensure the QImage is copied, as original data may not be valid after the method call
-
-        // Display the image in the UI
-        if (image_view) {
-            image_view->displayImage(img);
+        // Plugins work in BGR like the model, so the result is stored and shown as is
+        if (image_view && showResult(model->outputImage)) {
             qDebug() << "Custom instrument applied and image displayed.";
         }
 
@@ -77,6 +77,14 @@ public:
     void setDragging(bool enabled);
     bool isDraggingEnabled() const;
 
+    // Wraps an 8-bit model image (BGR, gray or BGRA) for display, sharing its buffer.
+    // Without keepAlive the QImage holds no reference, for callers that only read it
+    // before the Mat changes.
+    static QImage toQImage(const cv::Mat &image, bool keepAlive = true);
+
+    void setRoi(const QRect &rect); // Instruments process only this part of the image
+    void clearRoi();
+
     void loadPlugins(QMenu *menu);
     void applyCustomInstrument(PluginInstrument* instrument);
     QList<PluginInstrument*> getCustomInstruments() const;
@@ -99,7 +107,8 @@ public slots:
 
     void applyImpulseNoise();
     void applyVectorFilter();
-    void applyColorEnhancement();
+    void applyColorEnhancement(const std::string &method = "claheLuma"); // claheVideo for consecutive video frames
+    void resetColorEnhancementState();
 
     ImagingInstrumentsModel* getModel() const {
         return model;
@@ -121,6 +130,9 @@ signals:
     void themeChanged(const QString &theme);
 
 private:
+    // Pastes an instrument's result back into an active ROI, stores it as the new input image and shows it
+    bool showResult(const cv::Mat &result);
+
     bool impulseNoiseMode = false;
     bool drawingMode = false;
     bool isDragging;
@@ -129,6 +141,31 @@ private:
     bool colorEnhancementEnabled = false;
     bool saveEnabled = false;
 
+    bool incrementalFilteringEnabled = false;
+    double changeThreshold = 4.0;
+    int refreshInterval = 30;
+    int cudaState = -1; // -1 unknown, 0 unavailable, 1 available
+
+    quint64 noiseSeed = 0; // 0 keeps the noise plugin's own per-instance seed
+
+    // Loaded once; it keeps its noise mask between density changes
+    PluginInterfaceNoise *noisePlugin = nullptr;
+    QObject *noisePluginObject = nullptr;
+    bool loadNoisePlugin();
+
+    PluginInterfaceColorEnhancement *colorEnhancementPlugin = nullptr;
+    QObject *colorEnhancementObject = nullptr;
+    bool loadColorEnhancementPlugin();
+
+    bool stackingEnabled = false;
+    QString stackingMode;
+    int stackingWindow = 8;
+
+    QRect videoRoi;
+
+    QString videoFormat;
+    int encoderThreads = 0;
+
     void setupVideoPlayer();
     bool checkCUDA();
 
@@ -151,6 +188,37 @@ public:
     bool isColorEnhancementEnabled() const;
     bool isSaveEnabled() const;
 
+    void setIncrementalFilteringEnabled(bool enabled);
+    void setChangeThreshold(double threshold);
+    void setRefreshInterval(int frames);
+    bool isIncrementalFilteringEnabled() const;
+    double getChangeThreshold() const;
+    int getRefreshInterval() const;
+
+    void setNoiseSeed(quint64 seed);
+    quint64 getNoiseSeed() const;
+
+    void setStackingEnabled(bool enabled);
+    void setStackingMode(const QString &mode);
+    void setStackingWindow(int frames);
+    bool isStackingEnabled() const;
+    QString getStackingMode() const;
+    int getStackingWindow() const;
+
+    // Fixed region for every frame of the clip, kept apart from the image ROI; null
+    // processes full frames
+    void setVideoRoi(const QRect &rect);
+    QRect getVideoRoi() const;
+
+    bool isCudaAvailable();
+
+    void setOutputPath(const QString &path);
+    void setVideoFormat(const QString &format);
+    void setEncoderThreads(int threads);
+    QString getOutputPath() const;
+    QString getVideoFormat() const;
+    int getEncoderThreads() const;
+
     void addCustomInstrumentActions(QMenu *menu);
 
    bool hasCustomInstruments() const;
@@ -0,0 +1,264 @@
+#include "dataset_generator.h"
+#include <QCoreApplication>
+#include <QFileInfo>
+#include <QPluginLoader>
+#include <QVariant>
+#include <cstring>
+
+#include "degradation_dataset.h"
+#include "frame_source.h"
+
+// SplitMix64 finalizer: turns structured inputs into well-spread 64-bit seeds
+static quint64 mixSeed(quint64 seed, quint64 value)
+{
+    quint64 z = seed + 0x9E3779B97F4A7C15ull * (value + 1);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+DatasetGenerator::DatasetGenerator(const DatasetOptions &options)
+    : options(options), noisePlugin(nullptr), noisePluginObject(nullptr)
+{
+}
+
+bool DatasetGenerator::isDatasetInvocation(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--generate-dataset") == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+QString DatasetGenerator::usage()
+{
+    return "Usage: imaging_instruments --generate-dataset <output file> --input <image|dir|video|synthetic:WxH> "
+           "[--input ...] [--frames <N>] [--seed <N>] [--noise <type[,type...]>] "
+           "[--levels <l[,l...]>] [--sizes <native|WxH[,...]>]\n"
+           "Noise types: salt_pepper, random_value, gaussian, poisson, mixed\n"
+           "Levels are densities for impulse noise and relative noise levels for the additive models.\n";
+}
+
+bool DatasetGenerator::parseArguments(const QStringList &arguments, DatasetOptions &options, QString &error)
+{
+    const QStringList known = DegradationDataset::noiseTypeNames();
+
+    for (int i = 1; i < arguments.size(); ++i) {
+        const QString &arg = arguments.at(i);
+        bool hasValue = i + 1 < arguments.size();
+
+        if (arg == "--generate-dataset" && hasValue) {
+            options.outputPath = arguments.at(++i);
+        } else if (arg == "--input" && hasValue) {
+            options.inputs << arguments.at(++i);
+        } else if (arg == "--frames" && hasValue) {
+            options.framesPerSource = arguments.at(++i).toInt();
+        } else if (arg == "--seed" && hasValue) {
+            bool ok = false;
+            options.seed = arguments.at(++i).toULongLong(&ok, 0);
+            if (!ok) {
+                error = "Invalid --seed, expected an unsigned integer.";
+                return false;
+            }
+        } else if (arg == "--noise" && hasValue) {
+            options.noiseTypes = arguments.at(++i).toLower().split(',', Qt::SkipEmptyParts);
+        } else if (arg == "--levels" && hasValue) {
+            options.levels.clear();
+            for (const QString &value : arguments.at(++i).split(',', Qt::SkipEmptyParts)) {
+                bool ok = false;
+                double level = value.toDouble(&ok);
+                if (!ok || level < 0.0 || level > 1.0) {
+                    error = "Invalid level: " + value + " (expected 0..1).";
+                    return false;
+                }
+                options.levels << level;
+            }
+        } else if (arg == "--sizes" && hasValue) {
+            options.sizes.clear();
+            for (const QString &value : arguments.at(++i).toLower().split(',', Qt::SkipEmptyParts)) {
+                if (value == "native") {
+                    options.sizes.push_back(cv::Size());
+                    continue;
+                }
+                QStringList size = value.split('x');
+                if (size.size() != 2 || size.at(0).toInt() <= 0 || size.at(1).toInt() <= 0) {
+                    error = "Invalid size: " + value + ", expected native or <W>x<H>.";
+                    return false;
+                }
+                options.sizes.push_back(cv::Size(size.at(0).toInt(), size.at(1).toInt()));
+            }
+        } else {
+            error = "Unknown or incomplete argument: " + arg;
+            return false;
+        }
+    }
+
+    if (options.outputPath.isEmpty()) {
+        error = "No output file given to --generate-dataset.";
+        return false;
+    }
+    if (options.inputs.isEmpty()) {
+        error = "No --input given.";
+        return false;
+    }
+    if (options.noiseTypes.isEmpty() || options.levels.isEmpty()) {
+        error = "Nothing to generate: empty noise type or level list.";
+        return false;
+    }
+    for (const QString &name : options.noiseTypes) {
+        if (!known.contains(name)) {
+            error = "Unknown noise type: " + name;
+            return false;
+        }
+    }
+    if (options.framesPerSource <= 0) {
+        error = "--frames must be positive.";
+        return false;
+    }
+    if (options.sizes.empty()) {
+        options.sizes.push_back(cv::Size());
+    }
+    return true;
+}
+
+bool DatasetGenerator::loadNoisePlugin()
+{
+    QString pluginPath = QCoreApplication::applicationDirPath() + "/libs/impulse_noise2";
+    QPluginLoader pluginLoader(pluginPath);
+    noisePluginObject = pluginLoader.instance();
+    noisePlugin = dynamic_cast<PluginInterfaceNoise*>(noisePluginObject);
+    if (!noisePlugin) {
+        fprintf(stderr, "dataset: could not load the noise plugin: %s\n",
+                pluginLoader.errorString().toLocal8Bit().constData());
+        return false;
+    }
+
+    // setProperty() only returns true for declared properties, which older builds lack
+    if (!noisePluginObject->setProperty("noiseType", "salt_pepper")
+        || !noisePluginObject->setProperty("seed", QVariant::fromValue(options.seed))) {
+        fprintf(stderr, "dataset: the noise plugin does not support seeds and noise types; rebuild it.\n");
+        return false;
+    }
+    noisePluginObject->setProperty("monotone", false);
+    return true;
+}
+
+bool DatasetGenerator::loadCleanImages()
+{
+    static const QStringList stackSuffixes = { "tif", "tiff" };
+
+    for (const QString &input : options.inputs) {
+        QFileInfo info(input);
+
+        // Plain still images are read directly; sequences, stacks, videos and synthetic
+        // patterns go through FrameSource
+        if (info.isFile() && !stackSuffixes.contains(info.suffix().toLower())) {
+            cv::Mat image = cv::imread(input.toStdString(), cv::IMREAD_COLOR);
+            if (!image.empty()) {
+                cleanImages.push_back(image);
+                continue;
+            }
+        }
+
+        std::unique_ptr<FrameSource> source = FrameSource::create(input);
+        if (!source || !source->isOpened()) {
+            fprintf(stderr, "dataset: could not open input %s\n", input.toLocal8Bit().constData());
+            return false;
+        }
+        cv::Mat frame;
+        for (int n = 0; n < options.framesPerSource && source->read(frame); ++n) {
+            cleanImages.push_back(frame.clone());
+        }
+    }
+
+    if (cleanImages.empty()) {
+        fprintf(stderr, "dataset: no clean images were read.\n");
+        return false;
+    }
+    return true;
+}
+
+int DatasetGenerator::run()
+{
+    if (!loadNoisePlugin() || !loadCleanImages()) {
+        return 1;
+    }
+
+    DegradationDatasetWriter writer(options.seed);
+    if (!writer.open(options.outputPath)) {
+        fprintf(stderr, "dataset: could not write %s: %s\n", options.outputPath.toLocal8Bit().constData(),
+                writer.errorString().toLocal8Bit().constData());
+        return 1;
+    }
+
+    const QStringList typeNames = DegradationDataset::noiseTypeNames();
+    cv::Mat clean, scaled, noisy; // clean either shares the original or points at scaled
+
+    for (size_t source = 0; source < cleanImages.size(); ++source) {
+        for (size_t s = 0; s < options.sizes.size(); ++s) {
+            const cv::Size &size = options.sizes[s];
+            const cv::Mat &original = cleanImages[source];
+            if (size.empty() || size == original.size()) {
+                clean = original;
+            } else {
+                bool shrinking = size.area() < original.size().area();
+                cv::resize(original, scaled, size, 0, 0, shrinking ? cv::INTER_AREA : cv::INTER_CUBIC);
+                clean = scaled;
+            }
+
+            qint64 cleanOffset = writer.addImage(clean);
+            if (cleanOffset < 0) {
+                fprintf(stderr, "dataset: write failed: %s\n", writer.errorString().toLocal8Bit().constData());
+                return 1;
+            }
+
+            for (const QString &typeName : options.noiseTypes) {
+                const int type = typeNames.indexOf(typeName);
+                noisePluginObject->setProperty("noiseType", typeName);
+
+                for (int l = 0; l < options.levels.size(); ++l) {
+                    // Position-derived seed: stable under changes to the rest of the sweep
+                    quint64 seed = mixSeed(options.seed, source);
+                    seed = mixSeed(seed, s);
+                    seed = mixSeed(seed, static_cast<quint64>(type));
+                    seed = mixSeed(seed, static_cast<quint64>(l));
+                    noisePluginObject->setProperty("seed", QVariant::fromValue(seed));
+
+                    noisePlugin->processImage(clean, noisy, static_cast<float>(options.levels[l]));
+
+                    qint64 noisyOffset = writer.addImage(noisy);
+                    if (noisyOffset < 0) {
+                        fprintf(stderr, "dataset: write failed: %s\n", writer.errorString().toLocal8Bit().constData());
+                        return 1;
+                    }
+
+                    DatasetRecord record = {};
+                    record.rows = static_cast<uint32_t>(clean.rows);
+                    record.cols = static_cast<uint32_t>(clean.cols);
+                    record.type = clean.type();
+                    record.noiseType = static_cast<uint32_t>(type);
+                    record.level = static_cast<float>(options.levels[l]);
+                    record.sourceIndex = static_cast<uint32_t>(source);
+                    record.seed = seed;
+                    record.cleanOffset = static_cast<uint64_t>(cleanOffset);
+                    record.noisyOffset = static_cast<uint64_t>(noisyOffset);
+                    record.payloadBytes = static_cast<uint64_t>(clean.total() * clean.elemSize());
+                    writer.addRecord(record);
+                }
+            }
+            fprintf(stderr, "dataset: image %d/%d at %dx%d done\n", static_cast<int>(source) + 1,
+                    static_cast<int>(cleanImages.size()), clean.cols, clean.rows);
+        }
+    }
+
+    if (!writer.finish()) {
+        fprintf(stderr, "dataset: could not finish %s: %s\n", options.outputPath.toLocal8Bit().constData(),
+                writer.errorString().toLocal8Bit().constData());
+        return 1;
+    }
+    fprintf(stderr, "dataset: wrote %d pairs to %s\n", writer.recordCount(),
+            options.outputPath.toLocal8Bit().constData());
+    return 0;
+}
@@ -0,0 +1,53 @@
+#ifndef DATASET_GENERATOR_H
+#define DATASET_GENERATOR_H
+
+#include <QList>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "plugin_interface.h"
+
+// Options for the headless corpus generator, e.g.
+//   imaging_instruments --generate-dataset bench.iids --input photos/ --sizes native,512x512 --seed 7
+struct DatasetOptions {
+    QString outputPath;
+    QStringList inputs;         // Image files, or anything FrameSource opens (directories, videos, synthetic:WxH)
+    int framesPerSource = 8;    // Frames taken from each sequence or video input
+    quint64 seed = 1;
+    QStringList noiseTypes = { "salt_pepper", "random_value", "gaussian", "poisson", "mixed" };
+    QList<double> levels = { 0.01, 0.05, 0.1, 0.2, 0.4 };
+    std::vector<cv::Size> sizes; // Empty size means the native resolution
+};
+
+// Sweeps noise types, levels and resolutions over a set of clean images, runs the
+// impulse_noise2 plugin for each combination and writes the pairs to a
+// DegradationDataset file. Each pair gets a seed derived from the master seed and
+// its (image, resolution, type, level) position, so the same options always
+// produce the same bytes, and appending a level or type keeps the existing pairs.
+class DatasetGenerator
+{
+public:
+    explicit DatasetGenerator(const DatasetOptions &options);
+
+    int run(); // Process exit code
+
+    static bool isDatasetInvocation(int argc, char *argv[]);
+    static bool parseArguments(const QStringList &arguments, DatasetOptions &options, QString &error);
+    static QString usage();
+
+private:
+    bool loadNoisePlugin();
+    bool loadCleanImages();
+
+    DatasetOptions options;
+    std::vector<cv::Mat> cleanImages; // 8-bit BGR
+    PluginInterfaceNoise *noisePlugin;
+    QObject *noisePluginObject;
+};
+
+#endif // DATASET_GENERATOR_H
@@ -0,0 +1,192 @@
+#include "degradation_dataset.h"
+#include <QDebug>
+#include <cstring>
+
+static const char DATASET_MAGIC[8] = { 'I', 'I', 'D', 'S', 'E', 'T', '0', '1' };
+static const uint32_t DATASET_VERSION = 1;
+static const qint64 PAYLOAD_ALIGNMENT = 64; // Cache line, and enough for any SIMD load
+
+DegradationDataset::DegradationDataset()
+    : base(nullptr), header(nullptr), records(nullptr)
+{
+}
+
+DegradationDataset::~DegradationDataset()
+{
+    close();
+}
+
+QStringList DegradationDataset::noiseTypeNames()
+{
+    // Same names, in the same order, as the noiseType property of the impulse_noise2 plugin
+    return { "salt_pepper", "random_value", "gaussian", "poisson", "mixed" };
+}
+
+bool DegradationDataset::open(const QString &path)
+{
+    close();
+
+    file.setFileName(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qDebug() << "DegradationDataset: could not open" << path << file.errorString();
+        return false;
+    }
+
+    qint64 fileSize = file.size();
+    if (fileSize < static_cast<qint64>(sizeof(DatasetHeader))) {
+        qDebug() << "DegradationDataset: file too small" << path;
+        close();
+        return false;
+    }
+
+    base = file.map(0, fileSize, QFileDevice::MapPrivateOption);
+    if (!base) {
+        qDebug() << "DegradationDataset: could not map" << path << file.errorString();
+        close();
+        return false;
+    }
+
+    header = reinterpret_cast<const DatasetHeader *>(base);
+    uint64_t tableEnd = header->tableOffset + static_cast<uint64_t>(header->recordCount) * sizeof(DatasetRecord);
+    if (std::memcmp(header->magic, DATASET_MAGIC, sizeof(DATASET_MAGIC)) != 0
+        || header->version != DATASET_VERSION
+        || header->fileSize != static_cast<uint64_t>(fileSize)
+        || tableEnd > static_cast<uint64_t>(fileSize)) {
+        qDebug() << "DegradationDataset: not a valid dataset file" << path;
+        close();
+        return false;
+    }
+    records = reinterpret_cast<const DatasetRecord *>(base + header->tableOffset);
+
+    // Reject records pointing outside the file before any view is handed out
+    for (uint32_t i = 0; i < header->recordCount; ++i) {
+        const DatasetRecord &r = records[i];
+        uint64_t expected = static_cast<uint64_t>(r.rows) * r.cols * CV_ELEM_SIZE(r.type);
+        if (r.payloadBytes != expected
+            || r.cleanOffset + r.payloadBytes > static_cast<uint64_t>(fileSize)
+            || r.noisyOffset + r.payloadBytes > static_cast<uint64_t>(fileSize)) {
+            qDebug() << "DegradationDataset: record" << i << "is out of range in" << path;
+            close();
+            return false;
+        }
+    }
+    return true;
+}
+
+void DegradationDataset::close()
+{
+    if (base) {
+        file.unmap(base);
+    }
+    if (file.isOpen()) {
+        file.close();
+    }
+    base = nullptr;
+    header = nullptr;
+    records = nullptr;
+}
+
+cv::Mat DegradationDataset::view(const DatasetRecord &record, uint64_t offset) const
+{
+    return cv::Mat(static_cast<int>(record.rows), static_cast<int>(record.cols), record.type, base + offset);
+}
+
+cv::Mat DegradationDataset::clean(int index) const
+{
+    return view(records[index], records[index].cleanOffset);
+}
+
+cv::Mat DegradationDataset::noisy(int index) const
+{
+    return view(records[index], records[index].noisyOffset);
+}
+
+DegradationDatasetWriter::DegradationDatasetWriter(quint64 seed)
+    : seed(seed)
+{
+}
+
+DegradationDatasetWriter::~DegradationDatasetWriter()
+{
+    if (file.isOpen()) {
+        file.close();
+    }
+}
+
+bool DegradationDatasetWriter::open(const QString &path)
+{
+    file.setFileName(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return false;
+    }
+    records.clear();
+
+    // Placeholder until finish() knows the record count and table offset
+    DatasetHeader header = {};
+    return file.write(reinterpret_cast<const char *>(&header), sizeof(header)) == sizeof(header);
+}
+
+bool DegradationDatasetWriter::pad()
+{
+    qint64 remainder = file.pos() % PAYLOAD_ALIGNMENT;
+    if (remainder == 0) {
+        return true;
+    }
+    static const char zeros[PAYLOAD_ALIGNMENT] = {};
+    qint64 padding = PAYLOAD_ALIGNMENT - remainder;
+    return file.write(zeros, padding) == padding;
+}
+
+qint64 DegradationDatasetWriter::addImage(const cv::Mat &image)
+{
+    if (!pad()) {
+        return -1;
+    }
+    qint64 offset = file.pos();
+
+    if (image.isContinuous()) {
+        qint64 bytes = static_cast<qint64>(image.total() * image.elemSize());
+        if (file.write(reinterpret_cast<const char *>(image.data), bytes) != bytes) {
+            return -1;
+        }
+    } else {
+        qint64 rowBytes = static_cast<qint64>(image.cols * image.elemSize());
+        for (int y = 0; y < image.rows; ++y) {
+            if (file.write(reinterpret_cast<const char *>(image.ptr(y)), rowBytes) != rowBytes) {
+                return -1;
+            }
+        }
+    }
+    return offset;
+}
+
+void DegradationDatasetWriter::addRecord(const DatasetRecord &record)
+{
+    records.push_back(record);
+}
+
+bool DegradationDatasetWriter::finish()
+{
+    if (!pad()) {
+        return false;
+    }
+
+    DatasetHeader header = {};
+    std::memcpy(header.magic, DATASET_MAGIC, sizeof(DATASET_MAGIC));
+    header.version = DATASET_VERSION;
+    header.recordCount = static_cast<uint32_t>(records.size());
+    header.tableOffset = static_cast<uint64_t>(file.pos());
+    header.seed = seed;
+
+    qint64 tableBytes = static_cast<qint64>(records.size() * sizeof(DatasetRecord));
+    if (file.write(reinterpret_cast<const char *>(records.data()), tableBytes) != tableBytes) {
+        return false;
+    }
+    header.fileSize = static_cast<uint64_t>(file.pos());
+
+    if (!file.seek(0) || file.write(reinterpret_cast<const char *>(&header), sizeof(header)) != sizeof(header)) {
+        return false;
+    }
+    file.close();
+    return true;
+}
@@ -0,0 +1,105 @@
+#ifndef DEGRADATION_DATASET_H
+#define DEGRADATION_DATASET_H
+
+#include <QFile>
+#include <QString>
+#include <QStringList>
+
+#include <cstdint>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+// Container for clean/noisy image pairs used to benchmark the filters. Pixels are
+// stored raw, so a benchmark maps the file and reads them with no decode step.
+//
+// Layout (little endian):
+//   DatasetHeader                 64 bytes
+//   payloads                      continuous rows, each starting on a 64-byte boundary
+//   DatasetRecord[recordCount]    at header.tableOffset
+//
+// A clean image is stored once per resolution and shared by all of its noisy variants.
+
+struct DatasetHeader {
+    char magic[8];            // "IIDSET01"
+    uint32_t version;
+    uint32_t recordCount;
+    uint64_t tableOffset;
+    uint64_t seed;            // Master seed the corpus was generated from
+    uint64_t fileSize;
+    char reserved[24];
+};
+
+struct DatasetRecord {
+    uint32_t rows;
+    uint32_t cols;
+    int32_t type;             // OpenCV type of both images, e.g. CV_8UC3 (BGR)
+    uint32_t noiseType;       // Index into DegradationDataset::noiseTypeNames()
+    float level;              // Density for impulse noise, relative level for the additive models
+    uint32_t sourceIndex;     // Which input image the pair came from
+    uint64_t seed;            // Seed the noise plugin ran with for this pair
+    uint64_t cleanOffset;
+    uint64_t noisyOffset;
+    uint64_t payloadBytes;    // Size of each of the two images
+    uint64_t reserved;
+};
+
+static_assert(sizeof(DatasetHeader) == 64, "DatasetHeader must stay 64 bytes");
+static_assert(sizeof(DatasetRecord) == 64, "DatasetRecord must stay 64 bytes");
+
+// Read side: maps the whole file and hands out cv::Mat views into the mapping.
+// The mapping is private, so writing to a view never reaches the file.
+class DegradationDataset
+{
+public:
+    DegradationDataset();
+    ~DegradationDataset();
+
+    bool open(const QString &path);
+    void close();
+    bool isOpen() const { return base != nullptr; }
+
+    int size() const { return header ? static_cast<int>(header->recordCount) : 0; }
+    quint64 seed() const { return header ? header->seed : 0; }
+    const DatasetRecord &record(int index) const { return records[index]; }
+
+    // Zero-copy views, valid until close()
+    cv::Mat clean(int index) const;
+    cv::Mat noisy(int index) const;
+
+    static QStringList noiseTypeNames();
+
+private:
+    cv::Mat view(const DatasetRecord &record, uint64_t offset) const;
+
+    QFile file;
+    uchar *base;
+    const DatasetHeader *header;
+    const DatasetRecord *records;
+};
+
+// Write side: payloads are appended as they come, the record table and the
+// final header are written by finish()
+class DegradationDatasetWriter
+{
+public:
+    explicit DegradationDatasetWriter(quint64 seed);
+    ~DegradationDatasetWriter();
+
+    bool open(const QString &path);
+    qint64 addImage(const cv::Mat &image); // Offset of the payload, -1 on error
+    void addRecord(const DatasetRecord &record);
+    bool finish();
+
+    int recordCount() const { return static_cast<int>(records.size()); }
+    QString errorString() const { return file.errorString(); }
+
+private:
+    bool pad();
+
+    QFile file;
+    quint64 seed;
+    std::vector<DatasetRecord> records;
+};
+
+#endif // DEGRADATION_DATASET_H
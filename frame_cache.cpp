@@ -0,0 +1,58 @@
+#include "frame_cache.h"
+
+FrameCache::FrameCache(size_t budgetBytes)
+    : budgetBytes(budgetBytes), usedBytes(0)
+{
+}
+
+void FrameCache::insert(int frameNumber, const cv::Mat &frame)
+{
+    if (frame.empty() || frameBytes(frame) > budgetBytes) return;
+
+    auto it = entries.find(frameNumber);
+    if (it != entries.end()) {
+        usedBytes -= frameBytes(it->second.frame);
+        it->second.frame = frame;
+        recency.splice(recency.begin(), recency, it->second.position);
+    } else {
+        recency.push_front(frameNumber);
+        entries.emplace(frameNumber, Entry{ frame, recency.begin() });
+    }
+    usedBytes += frameBytes(frame);
+    evict();
+}
+
+bool FrameCache::find(int frameNumber, cv::Mat &frame)
+{
+    auto it = entries.find(frameNumber);
+    if (it == entries.end()) return false;
+
+    recency.splice(recency.begin(), recency, it->second.position);
+    frame = it->second.frame;
+    return true;
+}
+
+void FrameCache::clear()
+{
+    entries.clear();
+    recency.clear();
+    usedBytes = 0;
+}
+
+void FrameCache::setBudget(size_t bytes)
+{
+    budgetBytes = bytes;
+    evict();
+}
+
+void FrameCache::evict()
+{
+    while (usedBytes > budgetBytes && !recency.empty()) {
+        int oldest = recency.back();
+        recency.pop_back();
+
+        auto it = entries.find(oldest);
+        usedBytes -= frameBytes(it->second.frame);
+        entries.erase(it);
+    }
+}
@@ -0,0 +1,43 @@
+#ifndef FRAME_CACHE_H
+#define FRAME_CACHE_H
+
+#include <list>
+#include <unordered_map>
+
+#include <opencv2/opencv.hpp>
+
+// Least-recently-used cache of frames keyed by frame number, bounded by the
+// total bytes of pixel data it holds. Cached frames share their buffers with
+// the cv::Mat headers handed out by find(), so callers must treat them as
+// read-only and clone before modifying.
+class FrameCache
+{
+public:
+    explicit FrameCache(size_t budgetBytes = 256u * 1024u * 1024u);
+
+    void insert(int frameNumber, const cv::Mat &frame);
+    bool find(int frameNumber, cv::Mat &frame);
+    bool contains(int frameNumber) const { return entries.count(frameNumber) != 0; }
+    void clear();
+
+    void setBudget(size_t bytes);
+    size_t budget() const { return budgetBytes; }
+    size_t bytesUsed() const { return usedBytes; }
+    int size() const { return static_cast<int>(entries.size()); }
+
+private:
+    struct Entry {
+        cv::Mat frame;
+        std::list<int>::iterator position;
+    };
+
+    static size_t frameBytes(const cv::Mat &frame) { return frame.total() * frame.elemSize(); }
+    void evict();
+
+    size_t budgetBytes;
+    size_t usedBytes;
+    std::list<int> recency; // Front is the most recently used frame number
+    std::unordered_map<int, Entry> entries;
+};
+
+#endif // FRAME_CACHE_H
@@ -0,0 +1,470 @@
+#include "frame_source.h"
+#include <QCollator>
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QRegularExpression>
+#include <algorithm>
+
+static const QStringList IMAGE_SUFFIXES = {"png", "jpg", "jpeg", "bmp", "tif", "tiff", "pgm", "ppm", "exr"};
+
+double FrameSource::durationSeconds() const
+{
+    int count = frameCount();
+    double rate = fps();
+    return (count > 0 && rate > 0.0) ? count / rate : 0.0;
+}
+
+std::unique_ptr<FrameSource> FrameSource::create(const QString &path)
+{
+    std::unique_ptr<FrameSource> source;
+
+    if (path.startsWith("synthetic:", Qt::CaseInsensitive)) {
+        source = SyntheticSource::fromSpec(path);
+    } else {
+        QFileInfo info(path);
+        QString suffix = info.suffix().toLower();
+
+        if (info.isDir()) {
+            source.reset(new ImageSequenceSource(path));
+        } else if ((suffix == "tif" || suffix == "tiff") && TiffStackSource::pageCount(path) > 1) {
+            source.reset(new TiffStackSource(path));
+        } else if (IMAGE_SUFFIXES.contains(suffix) && ImageSequenceSource::isNumberedImage(path)) {
+            source.reset(new ImageSequenceSource(path));
+        } else {
+            source.reset(new VideoFileSource(path));
+        }
+    }
+
+    if (!source || !source->isOpened()) {
+        qDebug() << "FrameSource: could not open" << path;
+        return nullptr;
+    }
+    return source;
+}
+
+// ---------------------------------------------------------------- VideoFileSource
+
+VideoFileSource::VideoFileSource(const QString &path)
+    : path(path), frameRate(0.0), frames(-1), index(0)
+{
+    cap.open(path.toStdString());
+    if (!cap.isOpened()) return;
+
+    size = cv::Size(static_cast<int>(cap.get(cv::CAP_PROP_FRAME_WIDTH)),
+                    static_cast<int>(cap.get(cv::CAP_PROP_FRAME_HEIGHT)));
+    frameRate = cap.get(cv::CAP_PROP_FPS);
+    if (frameRate <= 0.0) frameRate = 30.0;
+
+    double count = cap.get(cv::CAP_PROP_FRAME_COUNT);
+    frames = count > 0 ? static_cast<int>(count) : -1;
+
+    keyframes.start(path);
+}
+
+bool VideoFileSource::read(cv::Mat &frame)
+{
+    if (!cap.read(frame)) return false; // read() decodes into frame's buffer when the size matches
+    ++index;
+    return true;
+}
+
+bool VideoFileSource::rewind()
+{
+    if (!cap.isOpened()) return false;
+    if (!cap.set(cv::CAP_PROP_POS_FRAMES, 0)) {
+        // Some backends cannot seek; reopening always lands on the first frame
+        cap.open(path.toStdString());
+    }
+    index = 0;
+    return cap.isOpened();
+}
+
+bool VideoFileSource::seek(int frameNumber)
+{
+    if (!cap.isOpened() || frameNumber < 0) return false;
+    if (frames > 0) frameNumber = std::min(frameNumber, frames - 1);
+    if (frameNumber == index) return true;
+
+    int keyframe = keyframes.keyframeAtOrBefore(frameNumber);
+
+    // Target is ahead in the same GOP: decoding on is cheaper than any seek
+    if (keyframe >= 0 && frameNumber > index && keyframe <= index) {
+        return grabForward(frameNumber);
+    }
+
+    if (keyframe >= 0) {
+        // Land exactly on the keyframe, then decode the few frames up to the target
+        cap.set(cv::CAP_PROP_POS_FRAMES, keyframe);
+        index = keyframe;
+        return grabForward(frameNumber);
+    }
+
+    // Not indexed yet; fall back to the backend's own (slower) accurate seek
+    cap.set(cv::CAP_PROP_POS_FRAMES, frameNumber);
+    index = frameNumber;
+    return true;
+}
+
+bool VideoFileSource::grabForward(int frameNumber)
+{
+    while (index < frameNumber) {
+        if (!cap.grab()) return false; // grab() decodes without the BGR conversion
+        ++index;
+    }
+    return true;
+}
+
+QString VideoFileSource::description() const
+{
+    return "Video " + QFileInfo(path).fileName();
+}
+
+// ---------------------------------------------------------------- ImageSequenceSource
+
+bool ImageSequenceSource::isNumberedImage(const QString &path)
+{
+    static const QRegularExpression trailingNumber("\\d+$");
+    return trailingNumber.match(QFileInfo(path).completeBaseName()).hasMatch();
+}
+
+ImageSequenceSource::ImageSequenceSource(const QString &path, double fps)
+    : frameRate(fps > 0.0 ? fps : 30.0), index(0)
+{
+    QFileInfo info(path);
+    QCollator collator;
+    collator.setNumericMode(true);
+
+    if (info.isDir()) {
+        QDir dir(path);
+        QStringList filters;
+        for (const QString &suffix : IMAGE_SUFFIXES) {
+            filters << "*." + suffix;
+        }
+        QStringList names = dir.entryList(filters, QDir::Files);
+        std::sort(names.begin(), names.end(), collator);
+        for (const QString &name : names) {
+            files << dir.filePath(name);
+        }
+    } else {
+        // frame_0007.png -> every frame_<digits>.png in the same directory, in numeric order
+        static const QRegularExpression split("^(.*?)(\\d+)$");
+        QRegularExpressionMatch match = split.match(info.completeBaseName());
+        if (!match.hasMatch()) return;
+
+        QRegularExpression member("^" + QRegularExpression::escape(match.captured(1)) + "\\d+\\."
+                                      + QRegularExpression::escape(info.suffix()) + "$",
+                                  QRegularExpression::CaseInsensitiveOption);
+        QDir dir = info.dir();
+        QStringList names;
+        for (const QString &name : dir.entryList(QDir::Files)) {
+            if (member.match(name).hasMatch()) {
+                names << name;
+            }
+        }
+        std::sort(names.begin(), names.end(), collator);
+        for (const QString &name : names) {
+            files << dir.filePath(name);
+        }
+    }
+
+    if (files.isEmpty()) return;
+
+    cv::Mat first = cv::imread(files.first().toStdString(), cv::IMREAD_COLOR);
+    if (first.empty()) {
+        qDebug() << "ImageSequenceSource: could not read" << files.first();
+        files.clear();
+        return;
+    }
+    size = first.size();
+}
+
+bool ImageSequenceSource::read(cv::Mat &frame)
+{
+    while (index < files.size()) {
+        cv::Mat image = cv::imread(files[index++].toStdString(), cv::IMREAD_COLOR);
+        if (image.empty()) {
+            qDebug() << "ImageSequenceSource: skipping unreadable" << files[index - 1];
+            continue;
+        }
+        if (image.size() != size) {
+            cv::resize(image, frame, size, 0, 0, cv::INTER_AREA); // Keep the stream geometry constant
+        } else {
+            frame = image;
+        }
+        return true;
+    }
+    return false;
+}
+
+bool ImageSequenceSource::rewind()
+{
+    index = 0;
+    return isOpened();
+}
+
+bool ImageSequenceSource::seek(int frameNumber)
+{
+    if (frameNumber < 0 || frameNumber >= files.size()) return false;
+    index = frameNumber;
+    return true;
+}
+
+QString ImageSequenceSource::description() const
+{
+    return QString("Image sequence (%1 frames)").arg(files.size());
+}
+
+// ---------------------------------------------------------------- TiffStackSource
+
+int TiffStackSource::pageCount(const QString &path)
+{
+    try {
+        return static_cast<int>(cv::imcount(path.toStdString()));
+    } catch (const cv::Exception &e) {
+        qDebug() << "TiffStackSource: could not count pages:" << e.what();
+        return 0;
+    }
+}
+
+TiffStackSource::TiffStackSource(const QString &path, double fps)
+    : path(path.toStdString()), frameRate(fps > 0.0 ? fps : 30.0), pages(0), index(0)
+{
+    pages = pageCount(path);
+    if (pages <= 0) return;
+
+    // Only one page is decoded at a time; stacks can be far larger than memory
+    page.clear();
+    if (!cv::imreadmulti(this->path, page, 0, 1, cv::IMREAD_COLOR) || page.empty()) {
+        pages = 0;
+        return;
+    }
+    size = page.front().size();
+}
+
+bool TiffStackSource::read(cv::Mat &frame)
+{
+    if (index >= pages) return false;
+
+    page.clear();
+    if (!cv::imreadmulti(path, page, index++, 1, cv::IMREAD_COLOR) || page.empty()) {
+        return false;
+    }
+    if (page.front().size() != size) {
+        cv::resize(page.front(), frame, size, 0, 0, cv::INTER_AREA);
+    } else {
+        frame = page.front();
+    }
+    return true;
+}
+
+bool TiffStackSource::rewind()
+{
+    index = 0;
+    return isOpened();
+}
+
+bool TiffStackSource::seek(int frameNumber)
+{
+    if (frameNumber < 0 || frameNumber >= pages) return false;
+    index = frameNumber; // Pages are addressed directly, no decode needed
+    return true;
+}
+
+QString TiffStackSource::description() const
+{
+    return QString("TIFF stack (%1 pages)").arg(pages);
+}
+
+// ---------------------------------------------------------------- SyntheticSource
+
+SyntheticSource::SyntheticSource(const cv::Size &size, double fps, int frames)
+    : size(size), frameRate(fps > 0.0 ? fps : 30.0), frames(frames), index(0)
+{
+    if (size.empty()) return;
+
+    // Twice as wide as the frame so each frame is a shifted window into it
+    gradient.create(size.height, size.width * 2, CV_8UC3);
+    for (int y = 0; y < gradient.rows; ++y) {
+        cv::Vec3b *row = gradient.ptr<cv::Vec3b>(y);
+        for (int x = 0; x < gradient.cols; ++x) {
+            int phase = (x * 255) / size.width;
+            row[x] = cv::Vec3b(static_cast<uchar>(phase % 256),
+                               static_cast<uchar>((y * 255) / std::max(1, size.height - 1)),
+                               static_cast<uchar>(255 - phase % 256));
+        }
+    }
+}
+
+std::unique_ptr<SyntheticSource> SyntheticSource::fromSpec(const QString &spec)
+{
+    // synthetic:1920x1080@60:600
+    static const QRegularExpression format("^synthetic:(\\d+)x(\\d+)(?:@([0-9.]+))?(?::(\\d+))?$",
+                                           QRegularExpression::CaseInsensitiveOption);
+    QRegularExpressionMatch match = format.match(spec);
+    if (!match.hasMatch()) {
+        qDebug() << "SyntheticSource: expected synthetic:WxH[@fps][:frames], got" << spec;
+        return nullptr;
+    }
+
+    cv::Size size(match.captured(1).toInt(), match.captured(2).toInt());
+    double fps = match.captured(3).isEmpty() ? 30.0 : match.captured(3).toDouble();
+    int frames = match.captured(4).isEmpty() ? 300 : match.captured(4).toInt();
+    return std::unique_ptr<SyntheticSource>(new SyntheticSource(size, fps, frames));
+}
+
+bool SyntheticSource::read(cv::Mat &frame)
+{
+    if (frames >= 0 && index >= frames) return false;
+
+    int shift = (index * 4) % size.width;
+    gradient(cv::Rect(shift, 0, size.width, size.height)).copyTo(frame);
+
+    // Bouncing square gives the change detectors something local to track
+    int side = std::max(8, std::min(size.width, size.height) / 8);
+    int spanX = std::max(1, size.width - side);
+    int spanY = std::max(1, size.height - side);
+    int x = (index * 7) % (2 * spanX);
+    int y = (index * 5) % (2 * spanY);
+    if (x > spanX) x = 2 * spanX - x;
+    if (y > spanY) y = 2 * spanY - y;
+    cv::rectangle(frame, cv::Rect(x, y, side, side), cv::Scalar(255, 255, 255), cv::FILLED);
+
+    ++index;
+    return true;
+}
+
+bool SyntheticSource::rewind()
+{
+    index = 0;
+    return true;
+}
+
+bool SyntheticSource::seek(int frameNumber)
+{
+    if (frameNumber < 0 || (frames >= 0 && frameNumber >= frames)) return false;
+    index = frameNumber;
+    return true;
+}
+
+QString SyntheticSource::description() const
+{
+    return QString("Synthetic %1x%2").arg(size.width).arg(size.height);
+}
+
+// ---------------------------------------------------------------- PrefetchingFrameSource
+
+PrefetchingFrameSource::PrefetchingFrameSource(std::unique_ptr<FrameSource> source, int depth)
+    : source(std::move(source)), ring(std::max(2, depth)), head(0), filled(0),
+    finished(false), stopping(false), consumedIndex(0)
+{
+    if (isOpened()) {
+        start();
+    }
+}
+
+PrefetchingFrameSource::~PrefetchingFrameSource()
+{
+    stop();
+}
+
+void PrefetchingFrameSource::start()
+{
+    head = 0;
+    filled = 0;
+    finished = false;
+    stopping = false;
+    worker = std::thread(&PrefetchingFrameSource::run, this);
+}
+
+void PrefetchingFrameSource::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    slotFree.notify_all();
+    frameReady.notify_all();
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
+
+void PrefetchingFrameSource::run()
+{
+    const int slots = static_cast<int>(ring.size());
+    for (;;) {
+        int target;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            slotFree.wait(lock, [this, slots]() { return filled < slots || stopping; });
+            if (stopping) return;
+            target = (head + filled) % slots;
+        }
+
+        // The slot is not visible to the consumer until filled is bumped, so decode unlocked
+        Slot &slot = ring[target];
+        slot.index = source->position();
+        bool ok = source->read(slot.frame);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!ok) {
+                finished = true;
+            } else {
+                ++filled;
+            }
+        }
+        frameReady.notify_one();
+        if (!ok) return;
+    }
+}
+
+bool PrefetchingFrameSource::read(cv::Mat &frame)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    frameReady.wait(lock, [this]() { return filled > 0 || finished || stopping; });
+    if (filled == 0) return false;
+
+    Slot &slot = ring[head];
+    std::swap(frame, slot.frame);
+    consumedIndex = slot.index + 1;
+
+    // The caller's old buffer is recycled, unless something else still references it
+    if (slot.frame.u && slot.frame.u->refcount > 1) {
+        slot.frame.release();
+    }
+
+    head = (head + 1) % static_cast<int>(ring.size());
+    --filled;
+    lock.unlock();
+    slotFree.notify_one();
+    return true;
+}
+
+bool PrefetchingFrameSource::rewind()
+{
+    stop();
+    bool ok = source->rewind();
+    consumedIndex = 0;
+    if (ok) {
+        start();
+    }
+    return ok;
+}
+
+bool PrefetchingFrameSource::seek(int frameNumber)
+{
+    // Anything already decoded belongs to the old position
+    stop();
+    bool ok = source->seek(frameNumber);
+    consumedIndex = source->position();
+    start();
+    return ok;
+}
+
+int PrefetchingFrameSource::bufferedFrames() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return filled;
+}
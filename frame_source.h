@@ -0,0 +1,196 @@
+#ifndef FRAME_SOURCE_H
+#define FRAME_SOURCE_H
+
+#include <QString>
+#include <QStringList>
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "keyframe_index.h"
+
+// Sequential source of BGR frames. Implementations decode synchronously;
+// wrap them in a PrefetchingFrameSource to move decoding off the caller's thread.
+class FrameSource
+{
+public:
+    virtual ~FrameSource() = default;
+
+    virtual bool isOpened() const = 0;
+    virtual bool read(cv::Mat &frame) = 0;    // Next frame; false at the end of the source
+    virtual bool rewind() = 0;                // Back to the first frame
+    virtual bool seek(int frameNumber) = 0;   // The next read() returns this frame
+    virtual double fps() const = 0;
+    virtual int frameCount() const = 0;       // -1 when unknown
+    virtual cv::Size frameSize() const = 0;
+    virtual int position() const = 0;         // Index of the next frame read() returns
+    virtual QString description() const = 0;
+
+    double durationSeconds() const;
+
+    // Picks the implementation from the path:
+    //   synthetic:WxH[@fps][:frames]  generated test pattern
+    //   directory or numbered image   image sequence (frame_0001.png, frame_0002.png, ...)
+    //   multi-page .tif/.tiff         TIFF stack
+    //   anything else                 video file
+    static std::unique_ptr<FrameSource> create(const QString &path);
+};
+
+class VideoFileSource : public FrameSource
+{
+public:
+    explicit VideoFileSource(const QString &path);
+
+    bool isOpened() const override { return cap.isOpened(); }
+    bool read(cv::Mat &frame) override;
+    bool rewind() override;
+    bool seek(int frameNumber) override;
+    double fps() const override { return frameRate; }
+    int frameCount() const override { return frames; }
+    cv::Size frameSize() const override { return size; }
+    int position() const override { return index; }
+    QString description() const override;
+
+private:
+    bool grabForward(int frameNumber);
+
+    QString path;
+    cv::VideoCapture cap;
+    KeyframeIndex keyframes; // Built in the background while playback starts
+    double frameRate;
+    int frames;
+    cv::Size size;
+    int index;
+};
+
+class ImageSequenceSource : public FrameSource
+{
+public:
+    // Either a directory (all images, natural order) or one file of a numbered sequence
+    explicit ImageSequenceSource(const QString &path, double fps = 30.0);
+
+    bool isOpened() const override { return !files.isEmpty(); }
+    bool read(cv::Mat &frame) override;
+    bool rewind() override;
+    bool seek(int frameNumber) override;
+    double fps() const override { return frameRate; }
+    int frameCount() const override { return static_cast<int>(files.size()); }
+    cv::Size frameSize() const override { return size; }
+    int position() const override { return index; }
+    QString description() const override;
+
+    static bool isNumberedImage(const QString &path);
+
+private:
+    QStringList files;
+    double frameRate;
+    cv::Size size;
+    int index;
+};
+
+class TiffStackSource : public FrameSource
+{
+public:
+    explicit TiffStackSource(const QString &path, double fps = 30.0);
+
+    bool isOpened() const override { return pages > 0; }
+    bool read(cv::Mat &frame) override;
+    bool rewind() override;
+    bool seek(int frameNumber) override;
+    double fps() const override { return frameRate; }
+    int frameCount() const override { return pages; }
+    cv::Size frameSize() const override { return size; }
+    int position() const override { return index; }
+    QString description() const override;
+
+    static int pageCount(const QString &path);
+
+private:
+    std::string path;
+    double frameRate;
+    int pages;
+    cv::Size size;
+    int index;
+    std::vector<cv::Mat> page; // Reused single-page buffer for imreadmulti
+};
+
+// Moving gradient with a bouncing square, for testing and benchmarks without disk I/O
+class SyntheticSource : public FrameSource
+{
+public:
+    SyntheticSource(const cv::Size &size, double fps = 30.0, int frames = 300);
+
+    bool isOpened() const override { return !size.empty(); }
+    bool read(cv::Mat &frame) override;
+    bool rewind() override;
+    bool seek(int frameNumber) override;
+    double fps() const override { return frameRate; }
+    int frameCount() const override { return frames; }
+    cv::Size frameSize() const override { return size; }
+    int position() const override { return index; }
+    QString description() const override;
+
+    static std::unique_ptr<SyntheticSource> fromSpec(const QString &spec);
+
+private:
+    cv::Size size;
+    double frameRate;
+    int frames;
+    int index;
+    cv::Mat gradient; // Precomputed background, shifted per frame
+};
+
+// Decodes ahead of the consumer on a worker thread into a fixed ring of buffers.
+// read() hands over a ready slot by swapping cv::Mat headers, and the caller's
+// previous buffer goes back into the ring, so steady-state playback neither
+// allocates nor waits on disk or decode as long as the decoder keeps up.
+class PrefetchingFrameSource : public FrameSource
+{
+public:
+    explicit PrefetchingFrameSource(std::unique_ptr<FrameSource> source, int depth = 4);
+    ~PrefetchingFrameSource() override;
+
+    bool isOpened() const override { return source && source->isOpened(); }
+    bool read(cv::Mat &frame) override;
+    bool rewind() override;
+    bool seek(int frameNumber) override;
+    double fps() const override { return source->fps(); }
+    int frameCount() const override { return source->frameCount(); }
+    cv::Size frameSize() const override { return source->frameSize(); }
+    int position() const override { return consumedIndex; }
+    QString description() const override { return source->description(); }
+
+    int bufferedFrames() const;
+    int depth() const { return static_cast<int>(ring.size()); }
+
+private:
+    struct Slot {
+        cv::Mat frame;
+        int index = 0;
+    };
+
+    void start();
+    void stop();
+    void run();
+
+    std::unique_ptr<FrameSource> source;
+    std::vector<Slot> ring;
+    int head;   // Next slot the consumer takes
+    int filled; // Slots decoded and not yet consumed
+    bool finished;
+    bool stopping;
+    int consumedIndex;
+
+    std::thread worker;
+    mutable std::mutex mutex;
+    std::condition_variable frameReady;
+    std::condition_variable slotFree;
+};
+
+#endif // FRAME_SOURCE_H
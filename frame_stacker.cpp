@@ -0,0 +1,265 @@
+#include "frame_stacker.h"
+#include <QDebug>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+FrameStacker::FrameStacker()
+    : mode(StackMode::RunningMean), window(8), alignmentEnabled(true), alignmentSize(512),
+    sceneCutResponse(0.05), scale(1.0), historyHead(0), stacked(0), response(0.0)
+{
+}
+
+QStringList FrameStacker::modeNames()
+{
+    return { modeName(StackMode::RunningMean), modeName(StackMode::WindowedMean),
+            modeName(StackMode::WindowedMedian) };
+}
+
+QString FrameStacker::modeName(StackMode mode)
+{
+    switch (mode) {
+    case StackMode::RunningMean:    return "Running mean";
+    case StackMode::WindowedMean:   return "Windowed mean";
+    case StackMode::WindowedMedian: return "Windowed median";
+    }
+    return "Running mean";
+}
+
+StackMode FrameStacker::modeFromName(const QString &name)
+{
+    if (name.contains("median", Qt::CaseInsensitive)) return StackMode::WindowedMedian;
+    if (name.contains("windowed", Qt::CaseInsensitive)) return StackMode::WindowedMean;
+    return StackMode::RunningMean;
+}
+
+void FrameStacker::setMode(StackMode newMode)
+{
+    if (newMode != mode) {
+        mode = newMode;
+        reset();
+    }
+}
+
+void FrameStacker::setWindow(int frames)
+{
+    frames = std::max(1, frames);
+    if (frames != window) {
+        window = frames;
+        reset();
+    }
+}
+
+void FrameStacker::setAlignmentSize(int longSide)
+{
+    alignmentSize = std::max(64, longSide);
+    frameSize = cv::Size(); // Rebuild the registration buffers on the next frame
+}
+
+void FrameStacker::setSceneCutResponse(double value)
+{
+    sceneCutResponse = std::max(0.0, value);
+}
+
+void FrameStacker::reset()
+{
+    referenceSpectrum.release();
+    runningMean.release();
+    windowSum.release();
+    history.clear();
+    historyHead = 0;
+    stacked = 0;
+    shift = cv::Point2d();
+    response = 0.0;
+}
+
+void FrameStacker::prepareAlignment(const cv::Mat &frame)
+{
+    frameSize = frame.size();
+    scale = std::min(1.0, static_cast<double>(alignmentSize) / std::max(frame.cols, frame.rows));
+    smallSize = cv::Size(std::max(1, cvRound(frame.cols * scale)), std::max(1, cvRound(frame.rows * scale)));
+    dftSize = cv::Size(cv::getOptimalDFTSize(smallSize.width), cv::getOptimalDFTSize(smallSize.height));
+
+    // The window tapers the borders so the implicit periodic extension of the DFT does not dominate
+    cv::createHanningWindow(hanning, smallSize, CV_32F);
+    referenceSpectrum.release();
+}
+
+void FrameStacker::spectrumOf(const cv::Mat &frame, cv::Mat &result)
+{
+    cv::cvtColor(frame, gray, cv::COLOR_BGR2GRAY);
+    if (smallSize != frameSize) {
+        cv::resize(gray, small, smallSize, 0, 0, cv::INTER_AREA);
+    } else {
+        small = gray;
+    }
+
+    small.convertTo(windowed, CV_32F);
+    cv::multiply(windowed, hanning, windowed);
+    cv::copyMakeBorder(windowed, padded, 0, dftSize.height - smallSize.height,
+                       0, dftSize.width - smallSize.width, cv::BORDER_CONSTANT, cv::Scalar::all(0));
+    cv::dft(padded, result, cv::DFT_COMPLEX_OUTPUT);
+}
+
+bool FrameStacker::estimateShift(const cv::Mat &frame)
+{
+    if (referenceSpectrum.empty()) {
+        spectrumOf(frame, referenceSpectrum);
+        shift = cv::Point2d();
+        response = 1.0;
+        return true;
+    }
+
+    spectrumOf(frame, spectrum);
+
+    // Normalized cross-power spectrum; its inverse peaks at the displacement
+    cv::mulSpectrums(spectrum, referenceSpectrum, cross, 0, true);
+    cv::split(cross, planes);
+    cv::magnitude(planes[0], planes[1], magnitude);
+    magnitude += FLT_EPSILON;
+    cv::divide(planes[0], magnitude, planes[0]);
+    cv::divide(planes[1], magnitude, planes[1]);
+    cv::merge(planes, 2, cross);
+    cv::idft(cross, correlation, cv::DFT_REAL_OUTPUT | cv::DFT_SCALE);
+
+    cv::Point peak;
+    cv::minMaxLoc(correlation, nullptr, &response, nullptr, &peak);
+
+    // Sub-pixel refinement: centroid of the 3x3 neighbourhood, wrapping around the borders
+    double sum = 0.0, sx = 0.0, sy = 0.0;
+    for (int dy = -1; dy <= 1; ++dy) {
+        int y = (peak.y + dy + correlation.rows) % correlation.rows;
+        const float *row = correlation.ptr<float>(y);
+        for (int dx = -1; dx <= 1; ++dx) {
+            int x = (peak.x + dx + correlation.cols) % correlation.cols;
+            double value = std::max(0.0f, row[x]);
+            sum += value;
+            sx += value * dx;
+            sy += value * dy;
+        }
+    }
+    double px = peak.x + (sum > 0.0 ? sx / sum : 0.0);
+    double py = peak.y + (sum > 0.0 ? sy / sum : 0.0);
+
+    // Peaks past the middle are negative shifts
+    if (px > dftSize.width / 2.0) px -= dftSize.width;
+    if (py > dftSize.height / 2.0) py -= dftSize.height;
+
+    shift = cv::Point2d(px / scale, py / scale);
+    return true;
+}
+
+bool FrameStacker::process(const cv::Mat &frame, cv::Mat &output)
+{
+    if (frame.empty() || frame.type() != CV_8UC3) {
+        qDebug() << "FrameStacker: expected an 8-bit 3-channel frame.";
+        return false;
+    }
+
+    if (frame.size() != frameSize) {
+        reset();
+        prepareAlignment(frame);
+    }
+
+    if (alignmentEnabled) {
+        estimateShift(frame);
+
+        if (stacked > 0 && response < sceneCutResponse) {
+            // Nothing in common with the reference (cut or large motion): start a new stack here
+            reset();
+            std::swap(referenceSpectrum, spectrum);
+        }
+    }
+
+    if (alignmentEnabled && (std::abs(shift.x) > 0.01 || std::abs(shift.y) > 0.01)) {
+        // The frame is the reference displaced by shift; move it back
+        cv::Matx23d transform(1.0, 0.0, -shift.x,
+                              0.0, 1.0, -shift.y);
+        cv::warpAffine(frame, aligned, transform, frame.size(), cv::INTER_LINEAR, cv::BORDER_REPLICATE);
+    } else {
+        frame.copyTo(aligned);
+    }
+
+    accumulate(aligned, output);
+    return true;
+}
+
+void FrameStacker::accumulate(const cv::Mat &input, cv::Mat &output)
+{
+    output.create(input.size(), CV_8UC3);
+
+    if (mode == StackMode::RunningMean) {
+        int n = std::min(stacked + 1, window);
+        if (stacked == 0) {
+            input.convertTo(runningMean, CV_32F);
+        } else {
+            cv::accumulateWeighted(input, runningMean, 1.0 / n);
+        }
+        runningMean.convertTo(output, CV_8U);
+        ++stacked;
+        return;
+    }
+
+    if (static_cast<int>(history.size()) != window) {
+        history.assign(window, cv::Mat());
+        historyHead = 0;
+    }
+
+    cv::Mat &slot = history[historyHead];
+    bool full = stacked >= window; // The slot then holds the oldest frame in the window
+    if (!full) {
+        slot.create(input.size(), CV_8UC3);
+    }
+    int count = std::min(stacked + 1, window);
+    const int width = input.cols * 3;
+
+    if (mode == StackMode::WindowedMean) {
+        if (stacked == 0) {
+            windowSum.create(input.size(), CV_32SC3);
+            windowSum.setTo(cv::Scalar::all(0));
+        }
+
+        // One pass per row: update the running sum, replace the oldest frame and emit the mean
+        cv::parallel_for_(cv::Range(0, input.rows), [&](const cv::Range &rows) {
+            for (int y = rows.start; y < rows.end; ++y) {
+                const uchar *in = input.ptr<uchar>(y);
+                uchar *old = slot.ptr<uchar>(y);
+                int *sum = windowSum.ptr<int>(y);
+                uchar *out = output.ptr<uchar>(y);
+                for (int x = 0; x < width; ++x) {
+                    sum[x] += in[x] - (full ? old[x] : 0);
+                    old[x] = in[x];
+                    out[x] = static_cast<uchar>((sum[x] + count / 2) / count);
+                }
+            }
+        });
+    } else {
+        input.copyTo(slot);
+
+        std::vector<const cv::Mat *> frames;
+        for (int i = 0; i < count; ++i) {
+            frames.push_back(&history[i]);
+        }
+
+        cv::parallel_for_(cv::Range(0, input.rows), [&](const cv::Range &rows) {
+            std::vector<uchar> values(count);
+            std::vector<const uchar *> lines(count);
+            for (int y = rows.start; y < rows.end; ++y) {
+                for (int i = 0; i < count; ++i) {
+                    lines[i] = frames[i]->ptr<uchar>(y);
+                }
+                uchar *out = output.ptr<uchar>(y);
+                for (int x = 0; x < width; ++x) {
+                    for (int i = 0; i < count; ++i) {
+                        values[i] = lines[i][x];
+                    }
+                    std::nth_element(values.begin(), values.begin() + count / 2, values.end());
+                    out[x] = values[count / 2];
+                }
+            }
+        });
+    }
+
+    historyHead = (historyHead + 1) % window;
+    ++stacked;
+}
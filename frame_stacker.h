@@ -0,0 +1,77 @@
+#ifndef FRAME_STACKER_H
+#define FRAME_STACKER_H
+
+#include <QString>
+#include <QStringList>
+
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+enum class StackMode {
+    RunningMean,    // Cumulative mean, exponential once the window is full
+    WindowedMean,   // Mean of the last N aligned frames
+    WindowedMedian  // Median of the last N aligned frames, robust to transients
+};
+
+// Temporal stacking for low-light video. Each frame is registered to a reference
+// by phase correlation on a downscaled, windowed luma image, shifted into place
+// and folded into the stack. The reference spectrum, Hanning window and every
+// intermediate buffer are kept between frames, and the DFT runs at an optimal size.
+class FrameStacker
+{
+public:
+    FrameStacker();
+
+    void setMode(StackMode mode);
+    void setWindow(int frames);
+    void setAlignmentEnabled(bool enabled) { alignmentEnabled = enabled; }
+    void setAlignmentSize(int longSide);         // Long side of the image used for registration
+    void setSceneCutResponse(double response);   // Restart the stack below this peak height
+
+    void reset();
+    bool process(const cv::Mat &frame, cv::Mat &output);
+
+    int stackedFrames() const { return stacked; }
+    cv::Point2d lastShift() const { return shift; }
+    double lastResponse() const { return response; }
+
+    static StackMode modeFromName(const QString &name);
+    static QString modeName(StackMode mode);
+    static QStringList modeNames();
+
+private:
+    void prepareAlignment(const cv::Mat &frame);
+    void spectrumOf(const cv::Mat &frame, cv::Mat &spectrum);
+    bool estimateShift(const cv::Mat &frame);
+    void accumulate(const cv::Mat &aligned, cv::Mat &output);
+
+    StackMode mode;
+    int window;
+    bool alignmentEnabled;
+    int alignmentSize;
+    double sceneCutResponse;
+
+    // Registration state, rebuilt only when the frame geometry changes
+    cv::Size frameSize;
+    double scale;              // Registration image size / frame size
+    cv::Size smallSize;
+    cv::Size dftSize;
+    cv::Mat hanning;
+    cv::Mat referenceSpectrum;
+    cv::Mat gray, small, windowed, padded, spectrum, cross, correlation;
+    cv::Mat planes[2], magnitude;
+
+    // Stack state
+    cv::Mat aligned;
+    cv::Mat runningMean;               // CV_32FC3
+    cv::Mat windowSum;                 // CV_32SC3
+    std::vector<cv::Mat> history;      // Ring of aligned frames
+    int historyHead;
+    int stacked;
+
+    cv::Point2d shift;
+    double response;
+};
+
+#endif // FRAME_STACKER_H
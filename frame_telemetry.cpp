@@ -0,0 +1,195 @@
+#include "frame_telemetry.h"
+#include <QDebug>
+#include <QFile>
+#include <QTextStream>
+#include <algorithm>
+
+static double percentileOf(const std::deque<double> &values, double p)
+{
+    if (values.empty()) return 0.0;
+
+    std::vector<double> sorted(values.begin(), values.end());
+    size_t rank = static_cast<size_t>(p / 100.0 * (sorted.size() - 1) + 0.5);
+    std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+    return sorted[rank];
+}
+
+static void pushBounded(std::deque<double> &values, double value, int window)
+{
+    values.push_back(value);
+    while (static_cast<int>(values.size()) > window) {
+        values.pop_front();
+    }
+}
+
+FrameTelemetry::Stage::Stage(FrameTelemetry &telemetry, const QString &name)
+    : telemetry(telemetry), stage(telemetry.stageIndex(name)),
+    start(std::chrono::steady_clock::now())
+{
+}
+
+FrameTelemetry::Stage::~Stage()
+{
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    telemetry.record(stage, elapsed.count());
+}
+
+FrameTelemetry::FrameTelemetry(int window)
+    : window(std::max(1, window)), recording(false), frameCount(0), inFrame(false), hasLastFrameEnd(false)
+{
+}
+
+void FrameTelemetry::reset()
+{
+    stageNames.clear();
+    recent.clear();
+    recentTotals.clear();
+    recentIntervals.clear();
+    frames.clear();
+    frameCount = 0;
+    inFrame = false;
+    hasLastFrameEnd = false;
+}
+
+void FrameTelemetry::startRecording()
+{
+    frames.clear();
+    recording = true;
+}
+
+void FrameTelemetry::stopRecording()
+{
+    recording = false;
+    std::vector<FrameRecord>().swap(frames); // Hand the memory back, not just the size
+}
+
+int FrameTelemetry::stageIndex(const QString &name)
+{
+    int index = stageNames.indexOf(name);
+    if (index < 0) {
+        stageNames << name;
+        recent.emplace_back();
+        index = stageNames.size() - 1;
+    }
+    return index;
+}
+
+void FrameTelemetry::beginFrame(int frameNumber)
+{
+    current.frameNumber = frameNumber;
+    current.stageMs.assign(stageNames.size(), -1.0);
+    current.totalMs = 0.0;
+    frameStart = std::chrono::steady_clock::now();
+    inFrame = true;
+}
+
+void FrameTelemetry::record(const QString &stage, double milliseconds)
+{
+    record(stageIndex(stage), milliseconds);
+}
+
+void FrameTelemetry::record(int stage, double milliseconds)
+{
+    if (!inFrame) return;
+
+    if (stage >= static_cast<int>(current.stageMs.size())) {
+        current.stageMs.resize(stage + 1, -1.0);
+    }
+    // A stage that runs twice in one frame (e.g. per region) accumulates
+    current.stageMs[stage] = std::max(0.0, current.stageMs[stage]) + milliseconds;
+}
+
+void FrameTelemetry::endFrame()
+{
+    if (!inFrame) return;
+    inFrame = false;
+
+    auto now = std::chrono::steady_clock::now();
+    std::chrono::duration<double, std::milli> total = now - frameStart;
+    current.totalMs = total.count();
+
+    for (size_t i = 0; i < current.stageMs.size(); ++i) {
+        if (current.stageMs[i] >= 0.0) {
+            pushBounded(recent[i], current.stageMs[i], window);
+        }
+    }
+    pushBounded(recentTotals, current.totalMs, window);
+
+    if (hasLastFrameEnd) {
+        std::chrono::duration<double, std::milli> interval = now - lastFrameEnd;
+        pushBounded(recentIntervals, interval.count(), window);
+    }
+    lastFrameEnd = now;
+    hasLastFrameEnd = true;
+
+    ++frameCount;
+    if (recording) {
+        frames.push_back(current);
+    }
+}
+
+double FrameTelemetry::percentile(const QString &stage, double p) const
+{
+    int index = stageNames.indexOf(stage);
+    if (index < 0) return 0.0;
+    return percentileOf(recent[index], p);
+}
+
+double FrameTelemetry::fps() const
+{
+    if (recentIntervals.empty()) return 0.0;
+
+    double sum = 0.0;
+    for (double interval : recentIntervals) {
+        sum += interval;
+    }
+    double mean = sum / recentIntervals.size();
+    return mean > 0.0 ? 1000.0 / mean : 0.0;
+}
+
+QString FrameTelemetry::summary() const
+{
+    QString text = QString("%1 fps   frame p50 %2  p95 %3  p99 %4 ms\n")
+                       .arg(fps(), 0, 'f', 1)
+                       .arg(percentileOf(recentTotals, 50), 0, 'f', 1)
+                       .arg(percentileOf(recentTotals, 95), 0, 'f', 1)
+                       .arg(percentileOf(recentTotals, 99), 0, 'f', 1);
+
+    for (int i = 0; i < stageNames.size(); ++i) {
+        if (recent[i].empty()) continue;
+        text += QString("%1  p50 %2  p95 %3  p99 %4 ms\n")
+                    .arg(stageNames[i], -18)
+                    .arg(percentileOf(recent[i], 50), 0, 'f', 1)
+                    .arg(percentileOf(recent[i], 95), 0, 'f', 1)
+                    .arg(percentileOf(recent[i], 99), 0, 'f', 1);
+    }
+    return text.trimmed();
+}
+
+bool FrameTelemetry::writeCsv(const QString &path) const
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        qDebug() << "FrameTelemetry: could not write" << path;
+        return false;
+    }
+
+    QTextStream out(&file);
+    out << "frame";
+    for (const QString &name : stageNames) {
+        out << "," << QString(name).replace(' ', '_') << "_ms";
+    }
+    out << ",total_ms\n";
+
+    for (const FrameRecord &record : frames) {
+        out << record.frameNumber;
+        for (int i = 0; i < stageNames.size(); ++i) {
+            out << ",";
+            if (i < static_cast<int>(record.stageMs.size()) && record.stageMs[i] >= 0.0) {
+                out << QString::number(record.stageMs[i], 'f', 3);
+            }
+        }
+        out << "," << QString::number(record.totalMs, 'f', 3) << "\n";
+    }
+    return true;
+}
@@ -0,0 +1,74 @@
+#ifndef FRAME_TELEMETRY_H
+#define FRAME_TELEMETRY_H
+
+#include <QString>
+#include <QStringList>
+
+#include <chrono>
+#include <deque>
+#include <vector>
+
+// Per-frame, per-stage latency recorder for the video pipeline. Each frame is
+// bracketed by beginFrame()/endFrame(); stages inside it are timed with
+// FrameTelemetry::Stage. Recent frames feed rolling p50/p95/p99 per stage. Only
+// between startRecording() and stopRecording() is every frame kept, for the CSV
+// written at the end of an export, so plain playback uses bounded memory.
+class FrameTelemetry
+{
+public:
+    // Times one stage of the current frame for as long as it is in scope
+    class Stage
+    {
+    public:
+        Stage(FrameTelemetry &telemetry, const QString &name);
+        ~Stage();
+
+    private:
+        FrameTelemetry &telemetry;
+        int stage;
+        std::chrono::steady_clock::time_point start;
+    };
+
+    explicit FrameTelemetry(int window = 240);
+
+    void reset();
+    void startRecording(); // Drops earlier records
+    void stopRecording();  // Drops the records; write the CSV first
+    void beginFrame(int frameNumber);
+    void record(const QString &stage, double milliseconds);
+    void endFrame();
+
+    double percentile(const QString &stage, double p) const;
+    double fps() const;
+    int framesTimed() const { return frameCount; } // Since reset(), recorded or not
+
+    QString summary() const; // Multi-line text for the HUD
+    bool writeCsv(const QString &path) const;
+
+private:
+    struct FrameRecord {
+        int frameNumber;
+        std::vector<double> stageMs; // Indexed like stageNames; negative when the stage did not run
+        double totalMs;
+    };
+
+    int stageIndex(const QString &name);
+    void record(int stage, double milliseconds);
+
+    int window;
+    QStringList stageNames;
+    std::vector<std::deque<double>> recent; // Rolling window per stage
+    std::deque<double> recentTotals;
+    std::deque<double> recentIntervals;     // Time between consecutive endFrame() calls
+    std::vector<FrameRecord> frames;        // Only while recording
+    bool recording;
+    int frameCount;
+
+    bool inFrame;
+    FrameRecord current;
+    std::chrono::steady_clock::time_point frameStart;
+    std::chrono::steady_clock::time_point lastFrameEnd;
+    bool hasLastFrameEnd;
+};
+
+#endif // FRAME_TELEMETRY_H
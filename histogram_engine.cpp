@@ -0,0 +1,79 @@
+#include "histogram_engine.h"
+#include <opencv2/core/utility.hpp>
+#include <algorithm>
+#include <vector>
+
+// Two tables per channel, alternating between neighbouring pixels: runs of equal values
+// then increment different counters, instead of serializing on one load-add-store
+static const int COPIES = 2;
+
+template <int CN>
+static void countRows(const cv::Mat &image, int firstRow, int lastRow, int stride, int sampledCols, uint32_t *tables)
+{
+    uint32_t *h0 = tables;
+    uint32_t *h1 = tables + CN * 256;
+    const size_t pixelStep = static_cast<size_t>(CN) * stride;
+
+    for (int r = firstRow; r < lastRow; ++r) {
+        const uchar *p = image.ptr<uchar>(r * stride);
+        int x = 0;
+        for (; x + 1 < sampledCols; x += 2, p += 2 * pixelStep) {
+            for (int c = 0; c < CN; ++c) {
+                ++h0[c * 256 + p[c]];
+                ++h1[c * 256 + p[pixelStep + c]];
+            }
+        }
+        if (x < sampledCols) {
+            for (int c = 0; c < CN; ++c) {
+                ++h0[c * 256 + p[c]];
+            }
+        }
+    }
+}
+
+bool HistogramEngine::compute(const cv::Mat &image, ChannelHistograms &result, int stride)
+{
+    if (image.empty() || image.depth() != CV_8U || image.channels() > 4) {
+        return false;
+    }
+
+    stride = std::max(1, stride);
+    const int cn = image.channels();
+    const int sampledRows = (image.rows + stride - 1) / stride;
+    const int sampledCols = (image.cols + stride - 1) / stride;
+    const int stripes = std::max(1, std::min(sampledRows, cv::getNumThreads() * 4));
+    const size_t tableSize = static_cast<size_t>(COPIES) * cn * 256;
+
+    std::vector<uint32_t> partial(tableSize * stripes, 0);
+
+    cv::parallel_for_(cv::Range(0, stripes), [&](const cv::Range &range) {
+        for (int s = range.start; s < range.end; ++s) {
+            int first = static_cast<int>(static_cast<int64_t>(s) * sampledRows / stripes);
+            int last = static_cast<int>(static_cast<int64_t>(s + 1) * sampledRows / stripes);
+            uint32_t *tables = partial.data() + tableSize * s;
+            switch (cn) {
+            case 1: countRows<1>(image, first, last, stride, sampledCols, tables); break;
+            case 2: countRows<2>(image, first, last, stride, sampledCols, tables); break;
+            case 3: countRows<3>(image, first, last, stride, sampledCols, tables); break;
+            case 4: countRows<4>(image, first, last, stride, sampledCols, tables); break;
+            }
+        }
+    });
+
+    result.channels = cn;
+    result.stride = stride;
+    result.samples = static_cast<uint64_t>(sampledRows) * sampledCols;
+    for (int c = 0; c < cn; ++c) {
+        uint32_t *bins = result.bins[c].data();
+        std::fill(bins, bins + 256, 0u);
+        for (int s = 0; s < stripes; ++s) {
+            for (int copy = 0; copy < COPIES; ++copy) {
+                const uint32_t *table = partial.data() + tableSize * s + (static_cast<size_t>(copy) * cn + c) * 256;
+                for (int v = 0; v < 256; ++v) {
+                    bins[v] += table[v];
+                }
+            }
+        }
+    }
+    return true;
+}
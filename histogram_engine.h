@@ -0,0 +1,34 @@
+#ifndef HISTOGRAM_ENGINE_H
+#define HISTOGRAM_ENGINE_H
+
+#include <array>
+#include <cstdint>
+
+#include <opencv2/core.hpp>
+
+// 256-bin counts for every channel of an 8-bit image
+struct ChannelHistograms {
+    int channels = 0;
+    int stride = 1;          // 1 for exact counts, n when every n-th row and column was sampled
+    uint64_t samples = 0;    // Pixels counted per channel
+    std::array<std::array<uint32_t, 256>, 4> bins = {};
+
+    const uint32_t *channel(int c) const { return bins[c].data(); }
+};
+
+// Computes all channel histograms of an 8-bit image in one pass over the pixels.
+// Row stripes run in parallel, each into its own sub-histogram, and the stripes are
+// summed at the end, so threads never contend on a counter. A stride above 1 samples
+// a sparse grid, which is plenty for a preview.
+//
+// Nothing is cached. The plugins are built with their own copy of the engine, so the
+// application cannot share counts with them, and the widget gets a fresh buffer per
+// image anyway.
+class HistogramEngine
+{
+public:
+    // False for empty images, depths other than 8 bits and more than four channels
+    static bool compute(const cv::Mat &image, ChannelHistograms &result, int stride = 1);
+};
+
+#endif // HISTOGRAM_ENGINE_H
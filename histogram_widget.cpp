@@ -1,48 +1,137 @@
 #include "histogram_widget.h"
+#include <QGuiApplication>
+#include <QScreen>
+#include <QThreadPool>
+#include <algorithm>
+#include <cmath>
 
 HistogramWidget::HistogramWidget(QWidget* parent)
-    : QWidget(parent), chart(new QChart()), chartView(new QChartView(chart, this))
+    : QWidget(parent), link(std::make_shared<OwnerLink<HistogramWidget>>(this)), chart(new QChart()),
+    chartView(new QChartView(chart, this)), yMax(0.0), bgr(false), previewPixels(1 << 18),
+    busy(false), hasPending(false)
 {
     QVBoxLayout* layout = new QVBoxLayout(this);
     layout->addWidget(chartView);
     setLayout(layout);
+    setupSeries();
+
+    // Nothing is drawn faster than the screen can show it
+    int interval = 16;
+    if (QScreen* screen = QGuiApplication::primaryScreen()) {
+        if (screen->refreshRate() > 1.0) {
+            interval = std::max(1, static_cast<int>(std::lround(1000.0 / screen->refreshRate())));
+        }
+    }
+    refreshTimer.setSingleShot(true);
+    refreshTimer.setInterval(interval);
+    connect(&refreshTimer, &QTimer::timeout, this, &HistogramWidget::startPending);
 }
 
-void HistogramWidget::updateHistogram(const cv::Mat& image) {
-    std::vector<cv::Mat> histograms;
-    calculateHistogram(image, histograms);
-    chart->removeAllSeries(); // Clear previous series
+HistogramWidget::~HistogramWidget()
+{
+    link->detach(); // A job still running drops its result
+}
+
+void HistogramWidget::setupSeries() {
+    chart->legend()->hide();
+
+    axisX = new QValueAxis(chart);
+    axisX->setRange(0, 255);
+    axisX->setLabelFormat("%d");
+    axisX->setTickCount(5);
+    axisY = new QValueAxis(chart);
+    axisY->setRange(0, 1);
+    axisY->setLabelFormat("%.1f%%");
+    chart->addAxis(axisX, Qt::AlignBottom);
+    chart->addAxis(axisY, Qt::AlignLeft);
 
-    // Create series for each channel
     const QColor colors[] = { Qt::red, Qt::green, Qt::blue };
-    for (size_t i = 0; i < histograms.size(); ++i) {
-        chart->addSeries(createSeries(histograms[i], colors[i]));
+    for (int i = 0; i < 3; ++i) {
+        series[i] = new QLineSeries(chart);
+        series[i]->setColor(colors[i]);
+        chart->addSeries(series[i]);
+        series[i]->attachAxis(axisX);
+        series[i]->attachAxis(axisY);
     }
 
-    chart->createDefaultAxes(); // Create default axes
+    points.resize(256);
+    for (int i = 0; i < 256; ++i) {
+        points[i].setX(i);
+    }
     chartView->setRenderHint(QPainter::Antialiasing); // Enable anti-aliasing
 }
 
-void HistogramWidget::calculateHistogram(const cv::Mat& image, std::vector<cv::Mat>& histograms) {
-    // Assuming image is in BGR format, split into channels
-    cv::Mat bgrChannels[3];
-    cv::split(image, bgrChannels);
+void HistogramWidget::setBgr(bool enabled) {
+    bgr = enabled;
+}
 
-    histograms.resize(3);
-    int histSize = 256;
-    float range[] = { 0, 256 };
-    const float* histRange = { range };
+void HistogramWidget::setPreviewPixels(int pixels) {
+    previewPixels = std::max(1024, pixels);
+}
 
-    for (int i = 0; i < 3; ++i) {
-        cv::calcHist(&bgrChannels[i], 1, 0, cv::Mat(), histograms[i], 1, &histSize, &histRange);
+void HistogramWidget::updateHistogram(const cv::Mat& image) {
+    pendingImage = image;
+    hasPending = true;
+    if (!busy && !refreshTimer.isActive()) {
+        startPending();
+    }
+}
+
+void HistogramWidget::startPending() {
+    if (busy || !hasPending) {
+        return;
     }
+    busy = true;
+    hasPending = false;
+    cv::Mat image = pendingImage;
+    pendingImage.release();
+    const int stride = std::max(1, static_cast<int>(std::ceil(std::sqrt(static_cast<double>(image.total()) / previewPixels))));
+    refreshTimer.start();
+
+    std::shared_ptr<OwnerLink<HistogramWidget>> shared = link;
+    QThreadPool::globalInstance()->start([shared, image, stride]() {
+        ChannelHistograms result;
+        bool ok = HistogramEngine::compute(image, result, stride);
+
+        shared->post([result, ok](HistogramWidget* owner) {
+            if (ok) {
+                owner->applyHistograms(result);
+            }
+            owner->busy = false;
+            if (owner->hasPending && !owner->refreshTimer.isActive()) {
+                owner->startPending();
+            }
+        });
+    });
 }
 
-QLineSeries* HistogramWidget::createSeries(const cv::Mat& hist, const QColor& color) {
-    QLineSeries* series = new QLineSeries();
-    for (int i = 0; i < hist.rows; ++i) {
-        series->append(i, hist.at<float>(i));
+void HistogramWidget::applyHistograms(const ChannelHistograms& histograms) {
+    const bool single = histograms.channels < 3;
+    const double scale = histograms.samples > 0 ? 100.0 / histograms.samples : 0.0;
+
+    // Series are red, green, blue; map them to the image's channel order
+    const int source[3] = { single ? 0 : (bgr ? 2 : 0), 1, single ? 0 : (bgr ? 0 : 2) };
+    series[0]->setColor(single ? QColor(Qt::lightGray) : QColor(Qt::red));
+
+    double peak = 0.0;
+    for (int i = 0; i < 3; ++i) {
+        bool visible = i == 0 || !single;
+        series[i]->setVisible(visible);
+        if (!visible) {
+            continue;
+        }
+        const uint32_t* bins = histograms.channel(source[i]);
+        for (int v = 0; v < 256; ++v) {
+            double y = bins[v] * scale;
+            points[v].setY(y);
+            peak = std::max(peak, y);
+        }
+        series[i]->replace(points);
+    }
+
+    // Rescale only on a clear change, so the axis does not jitter from frame to frame
+    if (peak > yMax || peak < yMax * 0.5) {
+        yMax = std::max(0.1, peak * 1.1);
+        axisY->setRange(0, yMax);
     }
-    series->setColor(color);
-    return series;
 }
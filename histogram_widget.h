@@ -6,23 +6,58 @@
 #include <QChartView>
 #include <QLineSeries>
 #include <QValueAxis>
+#include <QTimer>
+#include <QVector>
+#include <QPointF>
 #include <opencv2/opencv.hpp>
 #include <QtCharts/QChart>
 
+#include <memory>
+
+#include "histogram_engine.h"
+#include "owner_link.h"
+
+// Live RGB histogram. The chart, its series and its axes are built once; new
+// counts replace the points in bulk. Histograms are computed on the thread pool,
+// at most one at a time and no more often than the screen refreshes; images that
+// arrive while one is in flight are coalesced, and only the newest is shown.
 class HistogramWidget : public QWidget {
     Q_OBJECT
 
 public:
     explicit HistogramWidget(QWidget* parent = nullptr);
+    ~HistogramWidget();
+
+    // Queues an 8-bit image. The Mat is shared, not copied, so the caller must not
+    // write into that buffer afterwards (hand over a new Mat per frame instead).
+    void updateHistogram(const cv::Mat& image);
 
-    void updateHistogram(const cv::Mat& image); // Method to update the histogram with a new image
+    void setBgr(bool bgr);               // Channel order of the images, RGB by default
+    void setPreviewPixels(int pixels);   // Sampling budget; larger images are strided
+
+private slots:
+    void startPending();
 
 private:
-    void calculateHistogram(const cv::Mat& image, std::vector<cv::Mat>& histograms);
-    QLineSeries* createSeries(const cv::Mat& hist, const QColor& color);
+    void applyHistograms(const ChannelHistograms& histograms);
+    void setupSeries();
+
+    std::shared_ptr<OwnerLink<HistogramWidget>> link; // Shared with the worker
 
     QChart* chart; // Chart for displaying the histogram
     QChartView* chartView; // View for the chart
+    QLineSeries* series[3];
+    QValueAxis* axisX;
+    QValueAxis* axisY;
+    QVector<QPointF> points;
+    double yMax;
+
+    QTimer refreshTimer;
+    bool bgr;
+    int previewPixels;
+    bool busy;
+    bool hasPending;
+    cv::Mat pendingImage;
 };
 
 #endif // HISTOGRAMWIDGET_H
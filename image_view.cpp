@@ -2,13 +2,22 @@
 #include "controller.h"
 #include "image_view.h"
 
+#include <cstring>
+
 ImageView::ImageView(QWidget *parent)
     : QMainWindow(parent),
     scene(new QGraphicsScene(this)),
     graphicsView(new QGraphicsView(this)),
+    imageItem(nullptr),
     controller(nullptr),
     isDragging(false),
-    overlayTextItem(nullptr)
+    overlayTextItem(nullptr),
+    noiseHud(nullptr),
+    roiItem(nullptr),
+    selectingRoi(false),
+    dragModeBeforeRoi(QGraphicsView::ScrollHandDrag),
+    histogramDock(nullptr),
+    histogramPanel(nullptr)
 {
     controller->logMessage("Initializing ImageView...", MessageType::STATUS_MSG);
 
@@ -29,6 +38,19 @@ ImageView::ImageView(QWidget *parent)
 
     setAcceptDrops(true);
     controller->logMessage("Drag and drop enabled", MessageType::STATUS_MSG);
+
+    // The rubber band reports its scene corners while dragging and a null rect on release
+    connect(graphicsView, &QGraphicsView::rubberBandChanged, this,
+            [this](QRect viewportRect, QPointF fromScene, QPointF toScene) {
+        if (!selectingRoi) {
+            return;
+        }
+        if (!viewportRect.isNull()) {
+            roiSelection = QRectF(fromScene, toScene).normalized();
+        } else {
+            finishRoiSelection();
+        }
+    });
 }
 
 
@@ -71,32 +93,150 @@ void ImageView::dropEvent(QDropEvent *event) {
 }
 
 
+// Bounding box of the pixels that differ between two images of the same size and format
+static QRect changedRect(const QImage &before, const QImage &after)
+{
+    if (before.size() != after.size() || before.format() != after.format() || after.depth() < 8) {
+        return after.rect();
+    }
+
+    const int bytesPerPixel = after.depth() / 8;
+    const int rowBytes = after.width() * bytesPerPixel;
+    int top = -1, bottom = -1, left = rowBytes, right = -1;
+    for (int y = 0; y < after.height(); ++y) {
+        const uchar *a = before.constScanLine(y);
+        const uchar *b = after.constScanLine(y);
+        if (std::memcmp(a, b, rowBytes) == 0) {
+            continue;
+        }
+        int first = 0;
+        while (a[first] == b[first]) {
+            ++first;
+        }
+        int last = rowBytes - 1;
+        while (a[last] == b[last]) {
+            --last;
+        }
+        if (top < 0) {
+            top = y;
+        }
+        bottom = y;
+        left = std::min(left, first);
+        right = std::max(right, last);
+    }
+    if (top < 0) {
+        return QRect();
+    }
+    return QRect(QPoint(left / bytesPerPixel, top), QPoint(right / bytesPerPixel, bottom));
+}
+
 void ImageView::displayImage(const QImage &image)
 {
     if (scene) {
-        controller->logMessage("Clearing previous scene items", MessageType::STATUS_MSG);
-        scene->clear();
-
         if (originalImage.isNull()) {
             originalImage = image;
             controller->logMessage("Storing the original image", MessageType::STATUS_MSG);
         }
 
-        QPixmap pixmap = QPixmap::fromImage(image);
-        scene->addPixmap(pixmap);
-        scene->setSceneRect(pixmap.rect());
+        bool itemAlive = imageItem && scene->items().contains(imageItem);
+        if (itemAlive && imageItem->image().size() == image.size()) {
+            // Same geometry: update the item in place, so zoom and pan stay where the user left them
+            QRect dirty = changedRect(currentImage, image);
+            bool mostlyChanged = 2ll * dirty.width() * dirty.height() > 1ll * image.width() * image.height();
+            if (imageItem->image().format() != image.format() || mostlyChanged) {
+                imageItem->setImage(image);
+            } else if (!dirty.isEmpty()) {
+                imageItem->updateRegion(image, dirty);
+            }
+            controller->logMessage(QString("Scene updated in place, changed region %1x%2")
+                                       .arg(dirty.width()).arg(dirty.height()), MessageType::STATUS_MSG);
+        } else {
+            if (itemAlive) {
+                scene->removeItem(imageItem);
+                delete imageItem;
+            }
 
-        graphicsView->fitInView(scene->sceneRect(), Qt::KeepAspectRatio);
-        controller->logMessage("Scene updated and fit to view", MessageType::STATUS_MSG);
+            // Tiled, so neither this nor a later zoom converts the whole image at once
+            imageItem = new TiledImageItem();
+            imageItem->setImage(image);
+            scene->addItem(imageItem);
+            scene->setSceneRect(imageItem->boundingRect());
+
+            graphicsView->fitInView(scene->sceneRect(), Qt::KeepAspectRatio);
+            controller->logMessage("Scene updated and fit to view", MessageType::STATUS_MSG);
+        }
 
         currentImage = image;
 
         if (controller && controller->isImpulseNoiseMode()) {
-            clearOverlays();
             add_overlay_noise();
-            controller->logMessage("Overlay noise re-applied", MessageType::STATUS_MSG);
         }
+        updateHistogramPanel();
+    }
+}
+
+void ImageView::updateImageRegion(const QImage &image, const QRect &dirty)
+{
+    // The scene may have been cleared behind our back (e.g. on a new drop); start over then
+    bool itemAlive = imageItem && scene && scene->items().contains(imageItem);
+    if (!itemAlive || imageItem->image().size() != image.size()
+        || currentImage.size() != image.size() || currentImage.format() != image.format()) {
+        displayImage(image.copy());
+        return;
+    }
+
+    QRect region = dirty.intersected(image.rect());
+    if (!region.isEmpty()) {
+        // Only the tiles and pyramid levels over the region are refreshed
+        imageItem->updateRegion(image, region);
+
+        // Keep the saved/current copy in sync for the same region only
+        QPainter imagePainter(&currentImage);
+        imagePainter.setCompositionMode(QPainter::CompositionMode_Source);
+        imagePainter.drawImage(region.topLeft(), image, region);
+    }
+
+    if (controller && controller->isImpulseNoiseMode()) {
+        add_overlay_noise(); // Density readout, a label outside the scene
+    }
+    updateHistogramPanel();
+}
+
+void ImageView::toggleHistogram(bool visible)
+{
+    if (!histogramDock) {
+        histogramDock = new QDockWidget("Histogram", this);
+        histogramPanel = new HistogramWidget(histogramDock);
+        histogramDock->setWidget(histogramPanel);
+        histogramDock->setMinimumHeight(200);
+        addDockWidget(Qt::BottomDockWidgetArea, histogramDock);
+    }
+    histogramDock->setVisible(visible);
+    updateHistogramPanel();
+}
+
+void ImageView::updateHistogramPanel()
+{
+    if (!histogramDock || !histogramDock->isVisible() || currentImage.isNull()) {
+        return;
     }
+
+    // The panel reads the pixels on another thread, and currentImage is painted in place,
+    // so it gets its own copy
+    cv::Mat pixels;
+    histogramPanel->setBgr(currentImage.format() == QImage::Format_BGR888);
+    if (currentImage.format() == QImage::Format_Grayscale8) {
+        pixels = cv::Mat(currentImage.height(), currentImage.width(), CV_8UC1,
+                         const_cast<uchar*>(currentImage.constBits()), currentImage.bytesPerLine()).clone();
+    } else if (currentImage.format() == QImage::Format_BGR888) {
+        pixels = cv::Mat(currentImage.height(), currentImage.width(), CV_8UC3,
+                         const_cast<uchar*>(currentImage.constBits()), currentImage.bytesPerLine()).clone();
+    } else {
+        QImage rgb = currentImage.convertToFormat(QImage::Format_RGB888);
+        pixels = cv::Mat(rgb.height(), rgb.width(), CV_8UC3,
+                         const_cast<uchar*>(rgb.constBits()), rgb.bytesPerLine()).clone();
+    }
+    histogramPanel->updateHistogram(pixels);
 }
 
 void ImageView::clearImage()
@@ -104,7 +244,12 @@ void ImageView::clearImage()
     if (scene) {
         controller->logMessage("Clearing all items in the scene", MessageType::STATUS_MSG);
         scene->clear();
+        imageItem = nullptr;
+        roiItem = nullptr;
         scene->setSceneRect(0, 0, 0, 0);
+        if (noiseHud) {
+            noiseHud->hide();
+        }
         controller->logMessage("Scene rectangle reset", MessageType::STATUS_MSG);
 
         originalImage = QImage();
@@ -347,6 +492,12 @@ void ImageView::setupStandardActions(QMenu *menu)
     });
     menu->addAction(colorEnhancementAction);
 
+    QAction *histogramAction = new QAction("Histogram", this);
+    histogramAction->setCheckable(true);
+    histogramAction->setChecked(histogramDock && histogramDock->isVisible());
+    connect(histogramAction, &QAction::toggled, this, &ImageView::toggleHistogram);
+    menu->addAction(histogramAction);
+
     QAction *edgeDetectionAction = createAction("Edge Detection", this, [this]() {
         if (controller) {
             controller->applySobelFilter();
@@ -365,6 +516,10 @@ void ImageView::setupStandardActions(QMenu *menu)
 
 void ImageView::setupEditActions(QMenu *menu)
 {
+    menu->addAction(createAction("Select ROI", this, &ImageView::beginRoiSelection));
+    if (roiItem) {
+        menu->addAction(createAction("Clear ROI", this, &ImageView::clearRoi));
+    }
     menu->addAction(createAction("Save", this, &ImageView::saveImage));
     menu->addAction(createAction("Reset", this, [this]() {
         this->resetImage();
@@ -428,10 +583,8 @@ void ImageView::resetImage()
     const cv::Mat& originalImage = controller->getModel()->getOriginalInputImage();
 
     if (!originalImage.empty()) {
-        controller->getModel()->inputImage = originalImage.clone();
-
-        QImage resetImage(originalImage.data, originalImage.cols, originalImage.rows, originalImage.step, QImage::Format_RGB888);
-        displayImage(resetImage);
+        controller->getModel()->setInputImage(originalImage.clone());
+        displayImage(ImagingInstrumentsController::toQImage(controller->getModel()->inputImage));
 
         controller->logMessage("Image reset to original.", MessageType::STATUS_MSG);
     } else {
@@ -488,68 +641,51 @@ void ImageView::exitDrawingMode()
 }
 void ImageView::add_overlay_noise()
 {
-    clearOverlays();
-
-    int overlayWidth = currentImage.width();
-    int overlayHeight = currentImage.height();
-
-    QImage overlayImage = setup_inlay_noise(overlayWidth, overlayHeight);
-    draw_inlay_noise(overlayImage, overlayWidth, overlayHeight);
-
-    QPixmap overlayPixmap = QPixmap::fromImage(overlayImage);
-    QGraphicsPixmapItem *overlayItem = scene->addPixmap(overlayPixmap);
-    overlayItem->setZValue(10);
+    // Drawn in viewport coordinates on top of the view, so it costs the same at any image size and zoom
+    if (!noiseHud) {
+        noiseHud = new QLabel(graphicsView);
+        noiseHud->setAttribute(Qt::WA_TransparentForMouseEvents);
+        noiseHud->setStyleSheet("QLabel { background-color: rgba(128, 128, 128, 100); color: white;"
+                                " font-family: Verdana; font-size: 16px; padding: 10px; }");
+        graphicsView->installEventFilter(this);
+    }
 
-    controller->logMessage("Overlay noise added", MessageType::STATUS_MSG);
+    noiseHud->setText(QString("Noise Up/Down Ctrl + Wheel\nNoise Density: %1")
+                          .arg(controller ? controller->noise_density : 0.0));
+    positionNoiseHud();
+    noiseHud->show();
+    noiseHud->raise();
 }
 
-QImage ImageView::setup_inlay_noise(int overlayWidth, int overlayHeight)
+void ImageView::positionNoiseHud()
 {
-    QImage overlayImage(overlayWidth, overlayHeight, QImage::Format_ARGB32);
-    overlayImage.fill(Qt::transparent);
-    controller->logMessage("Setup inlay noise with dimensions: " + QString("%1 x %2").arg(overlayWidth).arg(overlayHeight), MessageType::STATUS_MSG);
-    return overlayImage;
+    if (!noiseHud) {
+        return;
+    }
+    QRect area = graphicsView->viewport()->geometry();
+    int height = noiseHud->sizeHint().height();
+    noiseHud->setGeometry(area.left(), area.bottom() + 1 - height, area.width(), height);
 }
 
-void ImageView::draw_inlay_noise(QImage &overlayImage, int overlayWidth, int overlayHeight)
+bool ImageView::eventFilter(QObject *watched, QEvent *event)
 {
-    QPainter painter(&overlayImage);
-    painter.setRenderHint(QPainter::Antialiasing);
-    painter.setRenderHint(QPainter::TextAntialiasing);
-
-    int overlayAreaHeight = overlayHeight * 0.25;
-    int overlayY = overlayHeight - overlayAreaHeight;
-
-    painter.setBrush(QColor(128, 128, 128, 100));
-    painter.drawRect(0, overlayY, overlayWidth, overlayAreaHeight);
-
-    int fontSize = overlayAreaHeight / 8;
-    painter.setPen(Qt::white);
-    painter.setFont(QFont("Verdana", fontSize));
-
-    int verticalOffset = overlayAreaHeight / 2;
-
-    QString controlText = "Noise Up/Down Ctrl + Wheel";
-    QRect controlTextRect = painter.boundingRect(QRect(0, 0, overlayWidth, overlayAreaHeight), Qt::AlignLeft, controlText);
-    painter.drawText(10, overlayY + verticalOffset - controlTextRect.height() / 2, controlText);
-
-    QString noiseDensityText = QString("Noise Density: %1").arg(controller ? controller->noise_density : 0.0);
-    QRect noiseDensityRect = painter.boundingRect(QRect(0, 0, overlayWidth, overlayAreaHeight), Qt::AlignLeft, noiseDensityText);
-    painter.drawText(10, overlayY + verticalOffset + 50, noiseDensityText);
-
-    controller->logMessage("Inlay noise drawn", MessageType::STATUS_MSG);
+    if (watched == graphicsView && event->type() == QEvent::Resize) {
+        positionNoiseHud();
+    }
+    return QMainWindow::eventFilter(watched, event);
 }
 
 void ImageView::clearOverlays()
 {
     controller->logMessage("Clearing all overlays", MessageType::STATUS_MSG);
 
+    if (noiseHud) {
+        noiseHud->hide();
+    }
+
     QList<QGraphicsItem*> itemsToRemove = scene->items();
     for (QGraphicsItem *item : itemsToRemove) {
-        if (dynamic_cast<QGraphicsPixmapItem*>(item) && item->zValue() == 10) {
-            scene->removeItem(item);
-            delete item; // Clean up
-        } else if (dynamic_cast<QGraphicsTextItem*>(item)) {
+        if (dynamic_cast<QGraphicsTextItem*>(item)) {
             scene->removeItem(item);
             delete item; // Clean up
         }
@@ -581,6 +717,50 @@ void ImageView::applyTheme(const QString &theme)
 
 }
 
+void ImageView::beginRoiSelection()
+{
+    if (currentImage.isNull()) {
+        return;
+    }
+    selectingRoi = true;
+    roiSelection = QRectF();
+    dragModeBeforeRoi = graphicsView->dragMode();
+    graphicsView->setDragMode(QGraphicsView::RubberBandDrag);
+    controller->logMessage("Drag a rectangle to select the region of interest", MessageType::STATUS_MSG);
+}
+
+void ImageView::finishRoiSelection()
+{
+    selectingRoi = false;
+    graphicsView->setDragMode(dragModeBeforeRoi);
+
+    QRect rect = roiSelection.toAlignedRect().intersected(currentImage.rect());
+    if (rect.width() < 2 || rect.height() < 2) {
+        controller->logMessage("Region of interest too small, ignored", MessageType::STATUS_MSG);
+        return;
+    }
+
+    if (!roiItem) {
+        QPen pen(QColor(0, 255, 127));
+        pen.setCosmetic(true); // Same width at any zoom
+        pen.setStyle(Qt::DashLine);
+        roiItem = scene->addRect(QRectF(), pen);
+        roiItem->setZValue(5);
+    }
+    roiItem->setRect(rect);
+    controller->setRoi(rect);
+}
+
+void ImageView::clearRoi()
+{
+    if (roiItem) {
+        scene->removeItem(roiItem);
+        delete roiItem;
+        roiItem = nullptr;
+    }
+    controller->clearRoi();
+}
+
 void ImageView::setDragging(bool enabled) {
     isDragging = enabled;
     if (isDragging) {
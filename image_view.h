@@ -11,9 +11,14 @@
 #include <QVBoxLayout>
 #include <QScreen>
 #include <QScrollBar>
+#include <QDockWidget>
+#include <QLabel>
+#include <QGraphicsRectItem>
 
 #include "plugin_interface.h"
 #include "custom_graphics_view.h"
+#include "histogram_widget.h"
+#include "tiled_image_item.h"
 
 class ImagingInstrumentsController; // Forward declaration
 
@@ -27,6 +32,7 @@ public:
 
     ImageView* imageView;
     void displayImage(const QImage &image);
+    void updateImageRegion(const QImage &image, const QRect &dirty); // Repaints only the changed area
     void setController(ImagingInstrumentsController *controller); // Add this method
     void resetImage();
     void clearImage();
@@ -40,6 +46,7 @@ private:
     bool paint_mode;
 
     QImage currentImage;
+    TiledImageItem *imageItem; // Item showing currentImage, nullptr when the scene was cleared
     ImagingInstrumentsController *controller;
 
     bool isDragging;
@@ -47,6 +54,23 @@ private:
 
     QImage originalImage;
     QGraphicsTextItem *overlayTextItem;
+    QLabel *noiseHud; // Impulse noise readout over the viewport, created on first use
+    void positionNoiseHud();
+
+    // Region of interest, picked with a rubber band; instruments then only process it
+    QGraphicsRectItem *roiItem;
+    bool selectingRoi;
+    QGraphicsView::DragMode dragModeBeforeRoi;
+    QRectF roiSelection;
+    void beginRoiSelection();
+    void finishRoiSelection();
+    void clearRoi();
+
+    // Live histogram of currentImage, created the first time it is shown
+    QDockWidget *histogramDock;
+    HistogramWidget *histogramPanel;
+    void toggleHistogram(bool visible);
+    void updateHistogramPanel();
 
     void setupImpulseNoiseModeActions(QMenu *menu);
     void setupDrawingModeActions(QMenu *menu);
@@ -85,8 +109,6 @@ private slots:
     void exitDrawingMode();
 
     void add_overlay_noise();
-    QImage setup_inlay_noise(int overlayWidth, int overlayHeight);
-    void draw_inlay_noise(QImage &overlayImage, int overlayWidth, int overlayHeight);
     void clearOverlays();
 
 protected:
@@ -96,6 +118,7 @@ protected:
     void handleZoom(QWheelEvent *event);
 
     void contextMenuEvent(QContextMenuEvent *event) override;
+    bool eventFilter(QObject *watched, QEvent *event) override;
 
 signals:
     void impulseNoiseRequested();
@@ -0,0 +1,145 @@
+#include "incremental_filter.h"
+#include <QDebug>
+#include <algorithm>
+
+// Above this fraction of changed tiles a single full-frame pass is cheaper than many regions
+static const double FULL_FRAME_FRACTION = 0.6;
+
+IncrementalFilter::IncrementalFilter()
+    : tileSize(64), halo(2), threshold(4.0), refreshInterval(30),
+    tilesX(0), tilesY(0), framesSinceRefresh(0), lastTilesReprocessed(0)
+{
+}
+
+void IncrementalFilter::setTileSize(int size) {
+    size = std::max(8, size);
+    if (size != tileSize) {
+        tileSize = size;
+        reset();
+    }
+}
+
+void IncrementalFilter::setHalo(int pixels) {
+    halo = std::max(0, pixels);
+}
+
+void IncrementalFilter::setThreshold(double meanAbsDiff) {
+    threshold = std::max(0.0, meanAbsDiff);
+}
+
+void IncrementalFilter::setRefreshInterval(int frames) {
+    refreshInterval = std::max(0, frames);
+}
+
+void IncrementalFilter::reset() {
+    referenceFrame.release();
+    cachedOutput.release();
+    changed.clear();
+    tilesX = 0;
+    tilesY = 0;
+    framesSinceRefresh = 0;
+    lastTilesReprocessed = 0;
+}
+
+bool IncrementalFilter::process(const cv::Mat &frame, cv::Mat &output, const Instrument &instrument) {
+    if (frame.empty()) return false;
+
+    bool geometryChanged = referenceFrame.size() != frame.size() || referenceFrame.type() != frame.type();
+    bool refreshDue = refreshInterval > 0 && framesSinceRefresh >= refreshInterval;
+
+    if (geometryChanged || refreshDue || cachedOutput.empty()) {
+        if (!processFull(frame, instrument)) return false;
+        cachedOutput.copyTo(output);
+        return true;
+    }
+
+    markChangedTiles(frame);
+
+    int changedCount = static_cast<int>(std::count(changed.begin(), changed.end(), 1));
+    if (changedCount > FULL_FRAME_FRACTION * tileCount()) {
+        if (!processFull(frame, instrument)) return false;
+        cachedOutput.copyTo(output);
+        return true;
+    }
+
+    // Merge horizontally adjacent changed tiles so the instrument runs on a few wide strips
+    for (int ty = 0; ty < tilesY; ++ty) {
+        int tx = 0;
+        while (tx < tilesX) {
+            if (!changed[ty * tilesX + tx]) {
+                ++tx;
+                continue;
+            }
+            int start = tx;
+            while (tx < tilesX && changed[ty * tilesX + tx]) {
+                ++tx;
+            }
+
+            cv::Rect region(start * tileSize, ty * tileSize, (tx - start) * tileSize, tileSize);
+            region &= cv::Rect(0, 0, frame.cols, frame.rows);
+            if (!processRegion(frame, region, instrument)) return false;
+        }
+    }
+
+    lastTilesReprocessed = changedCount;
+    ++framesSinceRefresh;
+    cachedOutput.copyTo(output);
+    return true;
+}
+
+bool IncrementalFilter::processFull(const cv::Mat &frame, const Instrument &instrument) {
+    tilesX = (frame.cols + tileSize - 1) / tileSize;
+    tilesY = (frame.rows + tileSize - 1) / tileSize;
+    changed.assign(static_cast<size_t>(tilesX) * tilesY, 0);
+
+    cv::Mat result;
+    if (!instrument(frame, result) || result.size() != frame.size()) {
+        qDebug() << "Incremental filter: full-frame instrument call failed.";
+        reset();
+        return false;
+    }
+
+    cachedOutput = result;
+    frame.copyTo(referenceFrame);
+    framesSinceRefresh = 1;
+    lastTilesReprocessed = tileCount();
+    return true;
+}
+
+void IncrementalFilter::markChangedTiles(const cv::Mat &frame) {
+    cv::absdiff(frame, referenceFrame, diff);
+
+    const double channels = static_cast<double>(frame.channels());
+    for (int ty = 0; ty < tilesY; ++ty) {
+        for (int tx = 0; tx < tilesX; ++tx) {
+            cv::Rect tile(tx * tileSize, ty * tileSize, tileSize, tileSize);
+            tile &= cv::Rect(0, 0, frame.cols, frame.rows);
+
+            cv::Scalar mean = cv::mean(diff(tile));
+            double meanAbsDiff = (mean[0] + mean[1] + mean[2] + mean[3]) / channels;
+            changed[ty * tilesX + tx] = meanAbsDiff > threshold ? 1 : 0;
+        }
+    }
+}
+
+bool IncrementalFilter::processRegion(const cv::Mat &frame, const cv::Rect &region, const Instrument &instrument) {
+    const cv::Rect bounds(0, 0, frame.cols, frame.rows);
+
+    // Output within halo of the region reads changed pixels too, so that band is written
+    // back as well; its own inputs reach another halo further out
+    cv::Rect written(region.x - halo, region.y - halo, region.width + 2 * halo, region.height + 2 * halo);
+    written &= bounds;
+    cv::Rect expanded(written.x - halo, written.y - halo, written.width + 2 * halo, written.height + 2 * halo);
+    expanded &= bounds;
+
+    // Instruments get a compact copy of the region; create() keeps the buffer between calls
+    frame(expanded).copyTo(regionInput);
+    if (!instrument(regionInput, regionOutput) || regionOutput.size() != expanded.size()) {
+        qDebug() << "Incremental filter: region instrument call failed.";
+        return false;
+    }
+
+    regionOutput(written - expanded.tl()).copyTo(cachedOutput(written));
+    frame(region).copyTo(referenceFrame(region));
+    return true;
+}
@@ -0,0 +1,55 @@
+#ifndef INCREMENTAL_FILTER_H
+#define INCREMENTAL_FILTER_H
+
+#include <functional>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+// Change-driven filtering for mostly static video (fixed inspection cameras).
+// Each frame is compared tile by tile against the input that produced the cached
+// output; only tiles whose mean absolute difference exceeds the threshold are
+// re-run through the instrument (with a halo so window filters see valid
+// neighbours), everything else reuses the previous output.
+class IncrementalFilter
+{
+public:
+    using Instrument = std::function<bool(const cv::Mat &input, cv::Mat &output)>;
+
+    IncrementalFilter();
+
+    void setTileSize(int size);
+    void setHalo(int pixels);
+    void setThreshold(double meanAbsDiff);
+    void setRefreshInterval(int frames); // 0 disables the forced refresh
+    void reset();
+
+    bool process(const cv::Mat &frame, cv::Mat &output, const Instrument &instrument);
+
+    int tilesReprocessed() const { return lastTilesReprocessed; }
+    int tileCount() const { return tilesX * tilesY; }
+
+private:
+    bool processFull(const cv::Mat &frame, const Instrument &instrument);
+    void markChangedTiles(const cv::Mat &frame);
+    bool processRegion(const cv::Mat &frame, const cv::Rect &region, const Instrument &instrument);
+
+    int tileSize;
+    int halo;
+    double threshold;
+    int refreshInterval;
+
+    int tilesX;
+    int tilesY;
+    int framesSinceRefresh;
+    int lastTilesReprocessed;
+
+    cv::Mat referenceFrame;  // input that produced each tile of cachedOutput
+    cv::Mat cachedOutput;
+    cv::Mat diff;
+    cv::Mat regionInput;
+    cv::Mat regionOutput;
+    std::vector<unsigned char> changed;
+};
+
+#endif // INCREMENTAL_FILTER_H
@@ -0,0 +1,92 @@
+#include "keyframe_index.h"
+#include <QDebug>
+#include <algorithm>
+
+#include <opencv2/opencv.hpp>
+
+KeyframeIndex::KeyframeIndex()
+    : stopping(false), complete(false), failed(false), indexed(0)
+{
+}
+
+KeyframeIndex::~KeyframeIndex()
+{
+    stop();
+}
+
+void KeyframeIndex::start(const QString &path)
+{
+    stop();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        keyframes.clear();
+        timestamps.clear();
+    }
+    stopping = false;
+    complete = false;
+    failed = false;
+    indexed = 0;
+    worker = std::thread(&KeyframeIndex::run, this, path.toStdString());
+}
+
+void KeyframeIndex::stop()
+{
+    stopping = true;
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
+
+void KeyframeIndex::run(std::string path)
+{
+    cv::VideoCapture probe;
+    try {
+        // Raw mode: grab() returns demuxed packets without running the decoder
+        probe.open(path, cv::CAP_FFMPEG, { cv::CAP_PROP_FORMAT, -1 });
+    } catch (const cv::Exception &e) {
+        qDebug() << "KeyframeIndex: could not open" << QString::fromStdString(path) << e.what();
+    }
+    if (!probe.isOpened()) {
+        failed = true;
+        return;
+    }
+
+    int frame = 0;
+    while (!stopping && probe.grab()) {
+        bool isKey = probe.get(cv::CAP_PROP_LRF_HAS_KEY_FRAME) != 0.0;
+        double msec = probe.get(cv::CAP_PROP_POS_MSEC);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (isKey || frame == 0) {
+                keyframes.push_back(frame); // The first packet is always decodable from the start
+            }
+            timestamps.push_back(msec);
+        }
+        indexed = ++frame;
+    }
+
+    if (!stopping) {
+        complete = true;
+        std::lock_guard<std::mutex> lock(mutex);
+        qDebug() << "KeyframeIndex:" << frame << "frames," << keyframes.size() << "keyframes";
+    }
+}
+
+int KeyframeIndex::keyframeAtOrBefore(int frame) const
+{
+    if (frame < 0 || frame >= indexed.load()) return -1;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = std::upper_bound(keyframes.begin(), keyframes.end(), frame);
+    if (it == keyframes.begin()) return -1;
+    return *(it - 1);
+}
+
+double KeyframeIndex::timestampMsec(int frame) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (frame < 0 || frame >= static_cast<int>(timestamps.size())) return -1.0;
+    return timestamps[frame];
+}
@@ -0,0 +1,45 @@
+#ifndef KEYFRAME_INDEX_H
+#define KEYFRAME_INDEX_H
+
+#include <QString>
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Builds a keyframe/timestamp table for a video file on a background thread.
+// It opens its own capture in raw-packet mode (CAP_PROP_FORMAT = -1), so
+// indexing only demuxes packets and never decodes pixels. Queries are valid for
+// the part of the file indexed so far and return -1 beyond it.
+class KeyframeIndex
+{
+public:
+    KeyframeIndex();
+    ~KeyframeIndex();
+
+    void start(const QString &path);
+    void stop();
+
+    bool isComplete() const { return complete.load(); }
+    bool hasFailed() const { return failed.load(); }
+    int indexedFrames() const { return indexed.load(); }
+
+    int keyframeAtOrBefore(int frame) const;
+    double timestampMsec(int frame) const;
+
+private:
+    void run(std::string path);
+
+    std::thread worker;
+    mutable std::mutex mutex;
+    std::vector<int> keyframes;      // Ascending frame numbers
+    std::vector<double> timestamps;  // Presentation time per frame, in ms
+
+    std::atomic<bool> stopping;
+    std::atomic<bool> complete;
+    std::atomic<bool> failed;
+    std::atomic<int> indexed;
+};
+
+#endif // KEYFRAME_INDEX_H
@@ -9,9 +9,42 @@
 #include <QFile>
 #include <QLockFile>
 #include "controller.h"
+#include "pipe_stream.h"
+#include "dataset_generator.h"
 
 int main(int argc, char *argv[])
 {
+    // Headless streaming mode: no GUI and no single-instance lock, so several
+    // filter stages can run side by side in ffmpeg/GStreamer pipelines
+    if (PipeStreamer::isPipeInvocation(argc, argv)) {
+        QCoreApplication pipeApp(argc, argv);
+
+        PipeOptions options;
+        QString error;
+        if (!PipeStreamer::parseArguments(pipeApp.arguments(), options, error)) {
+            fprintf(stderr, "%s\n%s", error.toLocal8Bit().constData(), PipeStreamer::usage().toLocal8Bit().constData());
+            return 2;
+        }
+
+        PipeStreamer streamer(options);
+        return streamer.run();
+    }
+
+    // Headless benchmark corpus generation, same rules as the pipe mode
+    if (DatasetGenerator::isDatasetInvocation(argc, argv)) {
+        QCoreApplication datasetApp(argc, argv);
+
+        DatasetOptions options;
+        QString error;
+        if (!DatasetGenerator::parseArguments(datasetApp.arguments(), options, error)) {
+            fprintf(stderr, "%s\n%s", error.toLocal8Bit().constData(), DatasetGenerator::usage().toLocal8Bit().constData());
+            return 2;
+        }
+
+        DatasetGenerator generator(options);
+        return generator.run();
+    }
+
     QApplication Imaging_Instruments(argc, argv);
 
     // Define a unique lock file path
@@ -3,63 +3,84 @@
 
 
 ImagingInstrumentsModel::ImagingInstrumentsModel(QObject *parent)
-    : QObject(parent)
+    : QObject(parent), roiActive(false)
 {
 }
 
-ImagingInstrumentsModel::~ImagingInstrumentsModel()
+void ImagingInstrumentsModel::setInputImage(const cv::Mat &image)
 {
-
+    inputImage = image;
+    planes.invalidate();
 }
 
-void ImagingInstrumentsModel::applyBlur()
+void ImagingInstrumentsModel::promoteToColor()
 {
-    if (inputImage.empty()) return;
+    if (inputImage.channels() == 1) {
+        cv::Mat color;
+        cv::cvtColor(inputImage, color, cv::COLOR_GRAY2BGR);
+        setInputImage(color);
+    }
+}
 
-    cv::Mat rgbImage;
-    cv::cvtColor(inputImage, rgbImage, cv::COLOR_BGR2RGB);
+ImagingInstrumentsModel::~ImagingInstrumentsModel()
+{
 
-    cv::GaussianBlur(rgbImage, outputImage, cv::Size(15, 15), 0); // Adjust kernel size as needed
 }
 
+bool ImagingInstrumentsModel::runVectorFilter(const cv::Mat &input, cv::Mat &output, bool useGpu)
+{
+    if (input.empty() || input.type() != CV_8UC3) {
+        qDebug() << "Error: vector filter expects a non-empty CV_8UC3 image.";
+        return false;
+    }
 
+    try {
+        if (useGpu) {
+            cv::Mat img_noisy_float;
+            input.convertTo(img_noisy_float, CV_32FC3);
+
+            cv::Mat img_clean_float(input.rows, input.cols, CV_32FC3);
+            run_gpu_filter(img_clean_float.ptr<float>(), img_noisy_float.ptr<float>(), input.rows, input.cols);
+
+            img_clean_float.convertTo(output, CV_8UC3);
+        } else {
+            // The DLL expects continuous buffers, so sub-regions are compacted first
+            cv::Mat source = input.isContinuous() ? input : input.clone();
+
+            ImageFiltering filter;
+            output = source.clone();
+            filter.run_filter(source, output);
+        }
+    } catch (const std::exception &e) {
+        qDebug() << "Vector filter execution failed:" << e.what();
+        return false;
+    }
 
-void ImagingInstrumentsModel::applyDeBlur() {
-    if (inputImage.empty()) return;
-
-    int iterations = 50;
-    cv::Mat rgbImage;
-    cv::cvtColor(inputImage, rgbImage, cv::COLOR_BGR2RGB);
-    cv::Mat inputFloat;
-    rgbImage.convertTo(inputFloat, CV_32F, 1.0 / 255.0);
+    if (output.type() == CV_32FC3) {
+        output.convertTo(output, CV_8UC3);
+    }
+    return !output.empty() && output.type() == CV_8UC3;
+}
 
-    outputImage = inputFloat.clone();
-    cv::Mat kernel = cv::getGaussianKernel(9, 2, CV_32F);
-    kernel = kernel * kernel.t();
+void ImagingInstrumentsModel::applyBlur()
+{
+    if (inputImage.empty()) return;
 
-    for (int i = 0; i < iterations; ++i) {
-        cv::Mat estimate = outputImage.clone();
-        cv::Mat convolved;
-        cv::filter2D(estimate, convolved, CV_32F, kernel);
+    cv::GaussianBlur(inputImage, outputImage, cv::Size(15, 15), 0); // Adjust kernel size as needed
+}
 
-        cv::Mat ratio;
-        cv::divide(inputFloat, convolved + 1e-6, ratio);
 
-        cv::threshold(ratio, ratio, 5.0, 5.0, cv::THRESH_TRUNC);
 
-        cv::Mat update;
-        cv::filter2D(ratio, update, CV_32F, kernel, cv::Point(-1, -1), 0, cv::BORDER_REPLICATE);
+void ImagingInstrumentsModel::applyDeBlur() {
+    if (inputImage.empty()) return;
 
-        outputImage = estimate.mul(update);
-        outputImage = cv::max(outputImage, 0.0f);
-        outputImage = cv::min(outputImage, 1.0f);
+    const cv::Mat &inputFloat = planes.unitFloat(inputImage);
 
-        double minVal, maxVal;
-        cv::minMaxLoc(outputImage, &minVal, &maxVal);
-        qDebug() << "Iteration:" << i << ", Min:" << minVal << ", Max:" << maxVal;
-    }
+    cv::Mat restored;
+    int iterations = deblur.deconvolve(inputFloat, restored);
+    restored.convertTo(outputImage, CV_8U, 255.0);
 
-    outputImage.convertTo(outputImage, CV_8U, 255.0);
+    qDebug() << "Deblur finished after" << iterations << "iterations";
 }
 
 
@@ -67,8 +88,7 @@ void ImagingInstrumentsModel::applySobelEdgeDetection()
 {
     if (inputImage.empty()) return;
 
-    cv::Mat grayImage;
-    cv::cvtColor(inputImage, grayImage, cv::COLOR_BGR2GRAY);
+    const cv::Mat &grayImage = planes.gray(inputImage);
 
     cv::Mat grad_x, grad_y;
     cv::Mat abs_grad_x, abs_grad_y;
@@ -92,14 +112,7 @@ void ImagingInstrumentsModel::applyBinarization(int threshold)
         return;
     }
 
-    cv::Mat grayImage;
-
-    if (inputImage.channels() == 3) {
-        cv::cvtColor(inputImage, grayImage, cv::COLOR_BGR2GRAY);
-        qDebug() << "Converted to grayscale.";
-    } else {
-        grayImage = inputImage;
-    }
+    const cv::Mat &grayImage = planes.gray(inputImage); // Converted once per input image
 
     cv::threshold(grayImage, outputImage, threshold, 255, cv::THRESH_BINARY);
 
@@ -107,105 +120,100 @@ void ImagingInstrumentsModel::applyBinarization(int threshold)
 }
 
 
-void ImagingInstrumentsModel::applyErosion(int erosionSize)
+void ImagingInstrumentsModel::applyErosion(int erosionSize, MorphologyEngine::Shape shape)
 {
     if (inputImage.empty()) {
         qDebug() << "Error: inputImage is empty before applying erosion.";
         return;
     }
 
-    cv::Mat grayImage;
-
-    if (inputImage.channels() == 3) {
-        cv::cvtColor(inputImage, grayImage, cv::COLOR_BGR2GRAY);
-        qDebug() << "Converted to grayscale.";
-    } else {
-        grayImage = inputImage;
+    // Binary images, e.g. after binarization, run on the packed bits: 64 pixels per word operation
+    const BinaryImage *binary = shape == MorphologyEngine::Rectangle ? planes.binary(inputImage) : nullptr;
+    if (binary) {
+        BinaryImage result;
+        binary->erode(erosionSize, erosionSize, result);
+        result.unpack(outputImage);
+        qDebug() << "Erosion applied to the packed binary image with kernel size:" << erosionSize;
+        return;
     }
 
-    cv::Mat element = cv::getStructuringElement(cv::MORPH_RECT,
-                                                cv::Size(2 * erosionSize + 1, 2 * erosionSize + 1),
-                                                cv::Point(erosionSize, erosionSize));
+    const cv::Mat &grayImage = planes.gray(inputImage);
 
-    cv::erode(grayImage, outputImage, element);
+    MorphologyEngine::erode(grayImage, outputImage, shape, erosionSize);
 
     qDebug() << "Erosion applied with kernel size:" << erosionSize;
 }
 
 
-void ImagingInstrumentsModel::applyDilation(int dilationSize)
+void ImagingInstrumentsModel::applyDilation(int dilationSize, MorphologyEngine::Shape shape)
 {
     if (inputImage.empty()) {
         qDebug() << "Error: inputImage is empty before applying dilation.";
         return;
     }
 
-    cv::Mat grayImage;
-
-    if (inputImage.channels() == 3) {
-        cv::cvtColor(inputImage, grayImage, cv::COLOR_BGR2GRAY);
-        qDebug() << "Converted to grayscale.";
-    } else {
-        grayImage = inputImage;
+    const BinaryImage *binary = shape == MorphologyEngine::Rectangle ? planes.binary(inputImage) : nullptr;
+    if (binary) {
+        BinaryImage result;
+        binary->dilate(dilationSize, dilationSize, result);
+        result.unpack(outputImage);
+        qDebug() << "Dilation applied to the packed binary image with kernel size:" << dilationSize;
+        return;
     }
 
-    cv::Mat element = cv::getStructuringElement(cv::MORPH_RECT,
-                                                cv::Size(2 * dilationSize + 1, 2 * dilationSize + 1),
-                                                cv::Point(dilationSize, dilationSize));
+    const cv::Mat &grayImage = planes.gray(inputImage);
 
-    cv::dilate(grayImage, outputImage, element);
+    MorphologyEngine::dilate(grayImage, outputImage, shape, dilationSize);
 
     qDebug() << "Dilation applied with kernel size:" << dilationSize;
 }
 
 
-void ImagingInstrumentsModel::applyOpening(int openingSize)
+void ImagingInstrumentsModel::applyOpening(int openingSize, MorphologyEngine::Shape shape)
 {
     if (inputImage.empty()) {
         qDebug() << "Error: inputImage is empty before applying opening.";
         return;
     }
 
-    cv::Mat grayImage;
-
-    if (inputImage.channels() == 3) {
-        cv::cvtColor(inputImage, grayImage, cv::COLOR_BGR2GRAY);
-        qDebug() << "Converted to grayscale.";
-    } else {
-        grayImage = inputImage;
+    const BinaryImage *binary = shape == MorphologyEngine::Rectangle ? planes.binary(inputImage) : nullptr;
+    if (binary) {
+        BinaryImage result;
+        binary->erode(openingSize, openingSize, result);
+        result.dilate(openingSize, openingSize, result);
+        result.unpack(outputImage);
+        qDebug() << "Opening applied to the packed binary image with kernel size:" << openingSize;
+        return;
     }
 
-    cv::Mat element = cv::getStructuringElement(cv::MORPH_RECT,
-                                                cv::Size(2 * openingSize + 1, 2 * openingSize + 1),
-                                                cv::Point(openingSize, openingSize));
+    const cv::Mat &grayImage = planes.gray(inputImage);
 
-    cv::morphologyEx(grayImage, outputImage, cv::MORPH_OPEN, element);
+    MorphologyEngine::open(grayImage, outputImage, shape, openingSize);
 
     qDebug() << "Opening applied with kernel size:" << openingSize;
 }
 
 
-void ImagingInstrumentsModel::applyClosing(int closingSize)
+void ImagingInstrumentsModel::applyClosing(int closingSize, MorphologyEngine::Shape shape)
 {
     if (inputImage.empty()) {
         qDebug() << "Error: inputImage is empty before applying closing.";
         return;
     }
 
-    cv::Mat grayImage;
-
-    if (inputImage.channels() == 3) {
-        cv::cvtColor(inputImage, grayImage, cv::COLOR_BGR2GRAY);
-        qDebug() << "Converted to grayscale.";
-    } else {
-        grayImage = inputImage;
+    const BinaryImage *binary = shape == MorphologyEngine::Rectangle ? planes.binary(inputImage) : nullptr;
+    if (binary) {
+        BinaryImage result;
+        binary->dilate(closingSize, closingSize, result);
+        result.erode(closingSize, closingSize, result);
+        result.unpack(outputImage);
+        qDebug() << "Closing applied to the packed binary image with kernel size:" << closingSize;
+        return;
     }
 
-    cv::Mat element = cv::getStructuringElement(cv::MORPH_RECT,
-                                                cv::Size(2 * closingSize + 1, 2 * closingSize + 1),
-                                                cv::Point(closingSize, closingSize));
+    const cv::Mat &grayImage = planes.gray(inputImage);
 
-    cv::morphologyEx(grayImage, outputImage, cv::MORPH_CLOSE, element);
+    MorphologyEngine::close(grayImage, outputImage, shape, closingSize);
 
     qDebug() << "Closing applied with kernel size:" << closingSize;
 }
@@ -215,3 +223,95 @@ void ImagingInstrumentsModel::updateDrawingImage(const QImage &drawing) {
         drawingImage = cv::Mat(drawing.height(), drawing.width(), CV_8UC4, (uchar*)drawing.bits(), drawing.bytesPerLine()).clone();
     }
 }
+
+void ImagingInstrumentsModel::setRoi(const cv::Rect &rect)
+{
+    roi = rect.area() > 0 ? rect : cv::Rect();
+}
+
+void ImagingInstrumentsModel::clearRoi()
+{
+    roi = cv::Rect();
+}
+
+bool ImagingInstrumentsModel::beginRoi(int halo)
+{
+    if (roiActive) {
+        endRoi(cv::Mat()); // Unbalanced call; drop the narrowing rather than nest it
+    }
+
+    cv::Rect bounds(0, 0, inputImage.cols, inputImage.rows);
+    cv::Rect inner = roi & bounds;
+    if (inner.area() == 0 || inner == bounds) {
+        return false;
+    }
+
+    halo = std::max(0, halo);
+    roiInner = inner;
+    roiOuter = cv::Rect(inner.x - halo, inner.y - halo, inner.width + 2 * halo, inner.height + 2 * halo) & bounds;
+    fullInputImage = inputImage;
+    inputImage = fullInputImage(roiOuter);
+    roiActive = true;
+    return true;
+}
+
+cv::Rect ImagingInstrumentsModel::roiInView() const
+{
+    if (!roiActive) {
+        return cv::Rect(0, 0, inputImage.cols, inputImage.rows);
+    }
+    return roiInner - roiOuter.tl();
+}
+
+cv::Mat ImagingInstrumentsModel::endRoi(const cv::Mat &result, cv::Rect *pasted)
+{
+    if (pasted) {
+        *pasted = cv::Rect();
+    }
+    if (!roiActive) {
+        return result;
+    }
+    roiActive = false;
+    inputImage = fullInputImage;
+    fullInputImage.release();
+
+    if (result.empty()) {
+        return inputImage;
+    }
+    if (result.size() != roiOuter.size()) {
+        qDebug() << "Error: ROI result does not match the processed region; keeping the image unchanged.";
+        return inputImage;
+    }
+
+    cv::Mat piece = result(roiInner - roiOuter.tl());
+
+    // The planes of the old pixels go first, so the cache does not count as an owner.
+    // A buffer nothing else references is pasted into in place; one the view, a stacker
+    // or a caller still holds is copied first, as they expect it unchanged.
+    planes.invalidate();
+    bool unique = inputImage.u && inputImage.u->refcount == 1;
+    cv::Mat composed = unique ? inputImage : inputImage.clone();
+
+    // Instruments may change the channel count (edges, masks); paste in the image's own format
+    if (piece.channels() != composed.channels()) {
+        cv::Mat converted;
+        if (piece.channels() == 1) {
+            cv::cvtColor(piece, converted, composed.channels() == 4 ? cv::COLOR_GRAY2BGRA : cv::COLOR_GRAY2BGR);
+        } else if (composed.channels() == 1) {
+            cv::cvtColor(piece, converted, piece.channels() == 4 ? cv::COLOR_BGRA2GRAY : cv::COLOR_BGR2GRAY);
+        } else {
+            cv::cvtColor(piece, converted, piece.channels() == 4 ? cv::COLOR_BGRA2BGR : cv::COLOR_BGR2BGRA);
+        }
+        piece = converted;
+    }
+    if (piece.depth() != composed.depth()) {
+        double scale = (piece.depth() == CV_32F || piece.depth() == CV_64F) && composed.depth() == CV_8U ? 255.0 : 1.0;
+        piece.convertTo(piece, composed.type(), scale);
+    }
+
+    piece.copyTo(composed(roiInner));
+    if (pasted) {
+        *pasted = roiInner;
+    }
+    return composed;
+}
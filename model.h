@@ -6,6 +6,10 @@
 #include <QDebug>
 #include <opencv2/opencv.hpp>
 
+#include "morphology_engine.h"
+#include "plane_cache.h"
+#include "richardson_lucy.h"
+
 class ImagingInstrumentsModel : public QObject
 {
     Q_OBJECT
@@ -14,7 +18,8 @@ public:
     explicit ImagingInstrumentsModel(QObject *parent = nullptr);
     ~ImagingInstrumentsModel();
 
-    // Example of member variables
+    // Images are 8-bit BGR, OpenCV's order, or single channel; the views wrap them as
+    // Format_BGR888 or Format_Grayscale8, so nothing is swapped or expanded on the way.
     cv::Mat inputImage;
     cv::Mat outputImage;
     cv::Mat outputImageRGB;
@@ -23,6 +28,11 @@ public:
     cv::Mat originalInputImage;
     cv::Mat drawingImage; // New member to hold the current drawing
 
+    // Replaces inputImage and drops its derived planes. Every new image goes through
+    // here: the cache keys on the buffer, and frames are often decoded into the same one.
+    void setInputImage(const cv::Mat &image);
+    void promoteToColor(); // Single-channel inputImage to BGR, for instruments that need color
+
     const cv::Mat& getOriginalInputImage() const {
         return originalInputImage;
     }
@@ -31,21 +41,46 @@ public:
         originalInputImage = image.clone(); // Store a clone to preserve original data
     }
 
+    // Runs the vector median filter (CUDA when useGpu is set, otherwise the CPU DLL)
+    // on any 8-bit color image, so callers can filter frames or sub-regions directly
+    bool runVectorFilter(const cv::Mat &input, cv::Mat &output, bool useGpu);
+
     void applySobelEdgeDetection();
     void applyBlur();
     void applyDeBlur();
 
 
     void applyBinarization(int threshold = 128);
-    void applyErosion(int erosionSize = 3);
-    void applyDilation(int dilationSize = 3);
-    void applyOpening(int openingSize = 3);
-    void applyClosing(int closingSize = 3);
+    void applyErosion(int erosionSize = 3, MorphologyEngine::Shape shape = MorphologyEngine::Rectangle);
+    void applyDilation(int dilationSize = 3, MorphologyEngine::Shape shape = MorphologyEngine::Rectangle);
+    void applyOpening(int openingSize = 3, MorphologyEngine::Shape shape = MorphologyEngine::Rectangle);
+    void applyClosing(int closingSize = 3, MorphologyEngine::Shape shape = MorphologyEngine::Rectangle);
 
     void updateDrawingImage(const QImage &drawing); // New method
 
+    // Region of interest in image coordinates; empty means the whole image. While
+    // narrowed, inputImage is a view (no copy) of the ROI grown by the instrument's
+    // halo, the border its kernel reads; only the ROI itself is pasted back.
+    void setRoi(const cv::Rect &rect);
+    void clearRoi();
+    const cv::Rect &getRoi() const { return roi; }
+    bool hasRoi() const { return roi.area() > 0; }
+
+    bool beginRoi(int halo);               // False, and inputImage untouched, without an ROI
+    // Full image with the ROI of result pasted in, in place when inputImage's buffer has
+    // no other owner; pasted, if given, gets the region written (empty if none)
+    cv::Mat endRoi(const cv::Mat &result, cv::Rect *pasted = nullptr);
+    cv::Rect roiInView() const;            // ROI relative to the narrowed inputImage
+
 private:
-         // Any private member functions or variables
+    PlaneCache planes; // Gray, float and packed binary planes of inputImage, computed on first use
+    RichardsonLucy deblur; // Keeps its planes, so deblurring video frames allocates nothing
+
+    cv::Rect roi;
+    cv::Rect roiInner;      // ROI clipped to the image, while narrowed
+    cv::Rect roiOuter;      // roiInner plus halo
+    cv::Mat fullInputImage; // inputImage while narrowed
+    bool roiActive;
 };
 
 #endif // MODEL_H
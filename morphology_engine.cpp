@@ -0,0 +1,308 @@
+#include "morphology_engine.h"
+#include <opencv2/core.hpp>
+#include <opencv2/core/utility.hpp>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+static const int STRIP_WIDTH = 64; // Columns per task in the vertical pass
+
+struct MinOp {
+    static uchar identity() { return 255; }
+    static uchar apply(uchar a, uchar b) { return std::min(a, b); }
+};
+
+struct MaxOp {
+    static uchar identity() { return 0; }
+    static uchar apply(uchar a, uchar b) { return std::max(a, b); }
+};
+
+// Window 2r+1 over n samples, outside samples being the identity. In padded
+// coordinates output i reads [i, i + 2r]: the suffix of its block in h plus the
+// prefix of the next block in g. Blocks start at multiples of the window length.
+template <class Op>
+static void runLine(const uchar *in, int n, int r, uchar *out, std::vector<uchar> &g, std::vector<uchar> &h)
+{
+    const int window = 2 * r + 1;
+    const int padded = (n + 2 * r + window - 1) / window * window;
+    g.resize(padded);
+    h.resize(padded);
+
+    for (int p = 0, inBlock = 0; p < padded; ++p) {
+        int i = p - r;
+        uchar v = i >= 0 && i < n ? in[i] : Op::identity();
+        g[p] = inBlock == 0 ? v : Op::apply(g[p - 1], v);
+        if (++inBlock == window) {
+            inBlock = 0;
+        }
+    }
+    for (int p = padded - 1, inBlock = 0; p >= 0; --p) {
+        int i = p - r;
+        uchar v = i >= 0 && i < n ? in[i] : Op::identity();
+        h[p] = inBlock == 0 ? v : Op::apply(h[p + 1], v);
+        if (++inBlock == window) {
+            inBlock = 0;
+        }
+    }
+    for (int i = 0; i < n; ++i) {
+        out[i] = Op::apply(h[i], g[i + 2 * r]);
+    }
+}
+
+template <class Op>
+static void horizontalPass(const cv::Mat &src, cv::Mat &dst, int r)
+{
+    cv::parallel_for_(cv::Range(0, src.rows), [&](const cv::Range &range) {
+        std::vector<uchar> g, h;
+        for (int y = range.start; y < range.end; ++y) {
+            runLine<Op>(src.ptr<uchar>(y), src.cols, r, dst.ptr<uchar>(y), g, h);
+        }
+    });
+}
+
+// Same scheme down the columns, a strip of neighbouring columns at a time so every
+// step is a contiguous run of bytes
+template <class Op>
+static void verticalPass(const cv::Mat &src, cv::Mat &dst, int r)
+{
+    const int rows = src.rows;
+    const int window = 2 * r + 1;
+    const int padded = (rows + 2 * r + window - 1) / window * window;
+    const int strips = (src.cols + STRIP_WIDTH - 1) / STRIP_WIDTH;
+
+    cv::parallel_for_(cv::Range(0, strips), [&](const cv::Range &range) {
+        std::vector<uchar> g(static_cast<size_t>(padded) * STRIP_WIDTH);
+        std::vector<uchar> h(static_cast<size_t>(padded) * STRIP_WIDTH);
+        const std::vector<uchar> outside(STRIP_WIDTH, Op::identity());
+
+        for (int strip = range.start; strip < range.end; ++strip) {
+            const int x0 = strip * STRIP_WIDTH;
+            const int width = std::min(STRIP_WIDTH, src.cols - x0);
+            auto sample = [&](int p) {
+                int y = p - r;
+                return y >= 0 && y < rows ? src.ptr<uchar>(y) + x0 : outside.data();
+            };
+
+            for (int p = 0, inBlock = 0; p < padded; ++p) {
+                const uchar *v = sample(p);
+                uchar *gp = g.data() + static_cast<size_t>(p) * STRIP_WIDTH;
+                if (inBlock == 0) {
+                    std::copy(v, v + width, gp);
+                } else {
+                    const uchar *prev = gp - STRIP_WIDTH;
+                    for (int x = 0; x < width; ++x) {
+                        gp[x] = Op::apply(prev[x], v[x]);
+                    }
+                }
+                if (++inBlock == window) {
+                    inBlock = 0;
+                }
+            }
+            for (int p = padded - 1, inBlock = 0; p >= 0; --p) {
+                const uchar *v = sample(p);
+                uchar *hp = h.data() + static_cast<size_t>(p) * STRIP_WIDTH;
+                if (inBlock == 0) {
+                    std::copy(v, v + width, hp);
+                } else {
+                    const uchar *next = hp + STRIP_WIDTH;
+                    for (int x = 0; x < width; ++x) {
+                        hp[x] = Op::apply(next[x], v[x]);
+                    }
+                }
+                if (++inBlock == window) {
+                    inBlock = 0;
+                }
+            }
+            for (int y = 0; y < rows; ++y) {
+                const uchar *hp = h.data() + static_cast<size_t>(y) * STRIP_WIDTH;
+                const uchar *gp = g.data() + static_cast<size_t>(y + 2 * r) * STRIP_WIDTH;
+                uchar *out = dst.ptr<uchar>(y) + x0;
+                for (int x = 0; x < width; ++x) {
+                    out[x] = Op::apply(hp[x], gp[x]);
+                }
+            }
+        }
+    });
+}
+
+// Lines at 45 degrees: each diagonal (step +1 in y) or anti-diagonal (step -1) is
+// gathered, run through the line filter and scattered back
+template <class Op>
+static void diagonalPass(const cv::Mat &src, cv::Mat &dst, int r, bool anti)
+{
+    const int rows = src.rows, cols = src.cols;
+    cv::parallel_for_(cv::Range(0, rows + cols - 1), [&](const cv::Range &range) {
+        std::vector<uchar> line, filtered, g, h;
+        for (int k = range.start; k < range.end; ++k) {
+            int x0, y0, length;
+            if (anti) {
+                y0 = std::min(k, rows - 1);
+                x0 = k - y0;
+                length = std::min(cols - x0, y0 + 1);
+            } else {
+                int offset = k - (rows - 1); // x - y
+                x0 = std::max(0, offset);
+                y0 = std::max(0, -offset);
+                length = std::min(cols - x0, rows - y0);
+            }
+            const int dy = anti ? -1 : 1;
+
+            line.resize(length);
+            filtered.resize(length);
+            for (int i = 0; i < length; ++i) {
+                line[i] = src.ptr<uchar>(y0 + dy * i)[x0 + i];
+            }
+            runLine<Op>(line.data(), length, r, filtered.data(), g, h);
+            for (int i = 0; i < length; ++i) {
+                dst.ptr<uchar>(y0 + dy * i)[x0 + i] = filtered[i];
+            }
+        }
+    });
+}
+
+// 3x3 cross
+template <class Op>
+static void crossPass(const cv::Mat &src, cv::Mat &dst)
+{
+    const int rows = src.rows, cols = src.cols;
+    cv::parallel_for_(cv::Range(0, rows), [&](const cv::Range &range) {
+        for (int y = range.start; y < range.end; ++y) {
+            const uchar *row = src.ptr<uchar>(y);
+            const uchar *above = y > 0 ? src.ptr<uchar>(y - 1) : row;
+            const uchar *below = y + 1 < rows ? src.ptr<uchar>(y + 1) : row;
+            uchar *out = dst.ptr<uchar>(y);
+            for (int x = 0; x < cols; ++x) {
+                uchar v = Op::apply(row[x], Op::apply(above[x], below[x]));
+                if (x > 0) {
+                    v = Op::apply(v, row[x - 1]);
+                }
+                if (x + 1 < cols) {
+                    v = Op::apply(v, row[x + 1]);
+                }
+                out[x] = v;
+            }
+        }
+    });
+}
+
+// Passes alternate between two buffers; only one pass ever reads a given buffer
+template <class Op>
+static void morphology(const cv::Mat &src, cv::Mat &dst, MorphologyEngine::Shape shape, int radius)
+{
+    // An axis-aligned pass never needs a value from outside the image, but a diagonal
+    // one can: the path to an in-image pixel may cross the border. Shapes with
+    // diagonals therefore run on a copy padded by the radius with the identity.
+    const bool diagonal = shape == MorphologyEngine::Diamond || shape == MorphologyEngine::Ellipse;
+    const int pad = diagonal ? radius : 0;
+    cv::Mat padded;
+    if (pad > 0) {
+        cv::copyMakeBorder(src, padded, pad, pad, pad, pad, cv::BORDER_CONSTANT, cv::Scalar(Op::identity()));
+    } else {
+        padded = src;
+    }
+
+    cv::Mat buffers[2];
+    buffers[0].create(padded.rows, padded.cols, CV_8UC1);
+    buffers[1].create(padded.rows, padded.cols, CV_8UC1);
+    const cv::Mat *current = &padded;
+    int next = 0;
+    auto step = [&](auto pass) {
+        pass(*current, buffers[next]);
+        current = &buffers[next];
+        next ^= 1;
+    };
+    auto horizontal = [](int r) { return [r](const cv::Mat &in, cv::Mat &out) { horizontalPass<Op>(in, out, r); }; };
+    auto vertical = [](int r) { return [r](const cv::Mat &in, cv::Mat &out) { verticalPass<Op>(in, out, r); }; };
+    auto diamond = [&](int r) {
+        // Two diagonal lines give the even points of |dx| + |dy| <= 2a; a cross
+        // fills the odd ones and grows it by one, twice when r is even
+        int a = (r - 1) / 2;
+        if (a > 0) {
+            step([a](const cv::Mat &in, cv::Mat &out) { diagonalPass<Op>(in, out, a, false); });
+            step([a](const cv::Mat &in, cv::Mat &out) { diagonalPass<Op>(in, out, a, true); });
+        }
+        for (int grown = 2 * a; grown < r; ++grown) {
+            step([](const cv::Mat &in, cv::Mat &out) { crossPass<Op>(in, out); });
+        }
+    };
+
+    switch (shape) {
+    case MorphologyEngine::Rectangle:
+        step(horizontal(radius));
+        step(vertical(radius));
+        break;
+    case MorphologyEngine::HorizontalLine:
+        step(horizontal(radius));
+        break;
+    case MorphologyEngine::VerticalLine:
+        step(vertical(radius));
+        break;
+    case MorphologyEngine::Diamond:
+        diamond(radius);
+        break;
+    case MorphologyEngine::Ellipse: {
+        // Square of half-width a plus diamond of radius r - a: a regular octagon for
+        // a = r (sqrt(2) - 1), reaching r along the axes and the diagonals alike
+        int a = static_cast<int>(std::lround(radius * (std::sqrt(2.0) - 1.0)));
+        if (a > 0) {
+            step(horizontal(a));
+            step(vertical(a));
+        }
+        diamond(radius - a);
+        break;
+    }
+    }
+
+    if (current == &padded) {
+        dst = src.clone(); // Radius 0
+    } else if (pad > 0) {
+        (*current)(cv::Rect(pad, pad, src.cols, src.rows)).copyTo(dst);
+    } else {
+        dst = *current;
+    }
+}
+
+static bool supported(const cv::Mat &src)
+{
+    return !src.empty() && src.type() == CV_8UC1;
+}
+
+bool MorphologyEngine::erode(const cv::Mat &src, cv::Mat &dst, Shape shape, int radius)
+{
+    if (!supported(src)) {
+        return false;
+    }
+    morphology<MinOp>(src, dst, shape, std::max(0, radius));
+    return true;
+}
+
+bool MorphologyEngine::dilate(const cv::Mat &src, cv::Mat &dst, Shape shape, int radius)
+{
+    if (!supported(src)) {
+        return false;
+    }
+    morphology<MaxOp>(src, dst, shape, std::max(0, radius));
+    return true;
+}
+
+bool MorphologyEngine::open(const cv::Mat &src, cv::Mat &dst, Shape shape, int radius)
+{
+    if (!supported(src)) {
+        return false;
+    }
+    cv::Mat eroded;
+    morphology<MinOp>(src, eroded, shape, std::max(0, radius));
+    morphology<MaxOp>(eroded, dst, shape, std::max(0, radius));
+    return true;
+}
+
+bool MorphologyEngine::close(const cv::Mat &src, cv::Mat &dst, Shape shape, int radius)
+{
+    if (!supported(src)) {
+        return false;
+    }
+    cv::Mat dilated;
+    morphology<MaxOp>(src, dilated, shape, std::max(0, radius));
+    morphology<MinOp>(dilated, dst, shape, std::max(0, radius));
+    return true;
+}
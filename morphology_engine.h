@@ -0,0 +1,35 @@
+#ifndef MORPHOLOGY_ENGINE_H
+#define MORPHOLOGY_ENGINE_H
+
+#include <opencv2/core.hpp>
+
+// Grayscale erosion and dilation whose cost per pixel does not depend on the size of
+// the structuring element. Lines run the van Herk/Gil-Werman algorithm: blocks of the
+// window length get running minima (or maxima) from both ends, and every output is one
+// comparison of the two, so a line of any length costs about three comparisons per
+// pixel. Larger shapes are sums of lines:
+//   Rectangle  horizontal line, then vertical line
+//   Diamond    the two diagonal lines, then one or two 3x3 crosses
+//   Ellipse    a rectangle and a diamond forming a regular octagon, which stands in
+//              for the disk
+// Rows, column strips and diagonals are split across threads. Pixels outside the image
+// never contribute, as with OpenCV's default border. Images are 8-bit single channel.
+class MorphologyEngine
+{
+public:
+    enum Shape {
+        Rectangle,      // (2r+1) x (2r+1)
+        Ellipse,        // Octagon inscribed in (2r+1) x (2r+1)
+        Diamond,        // |dx| + |dy| <= r
+        HorizontalLine, // 2r+1 wide
+        VerticalLine    // 2r+1 high
+    };
+
+    // False, and dst untouched, unless src is a non-empty CV_8UC1 image
+    static bool erode(const cv::Mat &src, cv::Mat &dst, Shape shape, int radius);
+    static bool dilate(const cv::Mat &src, cv::Mat &dst, Shape shape, int radius);
+    static bool open(const cv::Mat &src, cv::Mat &dst, Shape shape, int radius);  // Erode, then dilate
+    static bool close(const cv::Mat &src, cv::Mat &dst, Shape shape, int radius); // Dilate, then erode
+};
+
+#endif // MORPHOLOGY_ENGINE_H
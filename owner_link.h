@@ -0,0 +1,41 @@
+#ifndef OWNER_LINK_H
+#define OWNER_LINK_H
+
+#include <QMetaObject>
+
+#include <mutex>
+
+// Lets a job on the thread pool hand its result to the object that started it,
+// which may be deleted in the meantime. The job keeps a shared_ptr to the link and
+// the owner detaches in its destructor; post() queues the call on the owner's
+// thread only while the owner is still attached, under the lock detach() takes.
+// Queued calls for a deleted receiver are discarded, so the owner pointer is safe
+// once the call runs.
+template <class Owner>
+class OwnerLink
+{
+public:
+    explicit OwnerLink(Owner *owner) : owner(owner) {}
+
+    void detach()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        owner = nullptr;
+    }
+
+    // Runs call(owner) on the owner's thread; dropped once the owner is gone
+    template <class Call>
+    void post(Call call)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (Owner *target = owner) {
+            QMetaObject::invokeMethod(target, [target, call]() { call(target); }, Qt::QueuedConnection);
+        }
+    }
+
+private:
+    std::mutex mutex;
+    Owner *owner;
+};
+
+#endif // OWNER_LINK_H
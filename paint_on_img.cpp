@@ -3,6 +3,7 @@
 #include <QColorDialog>
 #include <QFileDialog>
 #include <QPainter>
+#include <QPaintEvent>
 
 
 
@@ -17,31 +18,30 @@ PaintOnImg::PaintOnImg(QWidget *parent)
 PaintOnImg::~PaintOnImg() {}
 
 void PaintOnImg::handleMousePressEvent(QMouseEvent *event) {
-    qDebug() << "handleMousePressEvent triggered";
     mousePressEvent(event); // Call the protected method
 }
 
 void PaintOnImg::handleMouseMoveEvent(QMouseEvent *event) {
-    qDebug() << "handleMouseMoveEvent triggered";
     mouseMoveEvent(event); // Call the protected method
 }
 
 void PaintOnImg::handleMouseReleaseEvent(QMouseEvent *event) {
-    qDebug() << "handleMouseReleaseEvent triggered";
     mouseReleaseEvent(event); // Call the protected method
 }
 
 void PaintOnImg::paintEvent(QPaintEvent *event) {
+    // Only the area asked for, which while drawing is the last segment's box
     QPainter painter(this);
-    painter.drawImage(0, 0, image);
-    qDebug() << "paintEvent triggered";
+    QRect area = event->rect();
+    painter.drawImage(area, image, area);
 }
 
 void PaintOnImg::mousePressEvent(QMouseEvent *event) {
-    qDebug() << "PaintOnImg mousePressEvent triggered";
     if (event->button() == Qt::LeftButton) {
         qDebug() << "Started drawing at:" << event->pos();
-        saveStateToUndo(); // Save current state before drawing
+        currentStroke = Stroke();
+        currentStroke.color = drawingColor;
+        currentStroke.points.append(event->pos());
         drawing = true;
         lastPoint = event->pos();
         event->accept(); // Accept the event to prevent further handling
@@ -51,47 +51,109 @@ void PaintOnImg::mousePressEvent(QMouseEvent *event) {
 }
 
 void PaintOnImg::mouseMoveEvent(QMouseEvent *event) {
-    qDebug() << "PaintOnImg mouseMoveEvent triggered";
     if (drawing) {
-        qDebug() << "Drawing line from" << lastPoint << "to" << event->pos();
-        QPainter painter(&image);
-        painter.setPen(QPen(drawingColor, 2, Qt::SolidLine, Qt::RoundCap, Qt::RoundJoin));
-        painter.drawLine(lastPoint, event->pos());
+        QRect segment = QRect(lastPoint, event->pos()).normalized()
+                            .adjusted(-PEN_WIDTH, -PEN_WIDTH, PEN_WIDTH, PEN_WIDTH);
+        captureTiles(currentStroke, segment); // Before the segment lands on them
+        drawSegment(lastPoint, event->pos(), currentStroke.color);
+        currentStroke.points.append(event->pos());
         lastPoint = event->pos();
-        update(); // Refresh the widget
-    } else {
-        qDebug() << "Mouse move without drawing";
+        update(segment);
+        markDirty(segment);
     }
 }
 
 void PaintOnImg::mouseReleaseEvent(QMouseEvent *event) {
-    qDebug() << "PaintOnImg mouseReleaseEvent triggered";
     if (event->button() == Qt::LeftButton) {
-        qDebug() << "Stopped drawing";
+        if (drawing && currentStroke.points.size() > 1) {
+            qDebug() << "Stopped drawing," << currentStroke.points.size() << "points,"
+                     << currentStroke.tilesBefore.size() << "tiles saved";
+            undoStack.push(currentStroke);
+            redoStack.clear();
+        }
+        currentStroke = Stroke();
         drawing = false;
+        flushDirty();
     } else {
         qDebug() << "Mouse release with non-left button:" << event->button();
     }
 }
 
-void PaintOnImg::saveStateToUndo() {
-    undoStack.push(QPixmap::fromImage(image));
-    redoStack.clear();
+QRect PaintOnImg::drawSegment(const QPoint &from, const QPoint &to, const QColor &color) {
+    QPainter painter(&image);
+    painter.setPen(QPen(color, PEN_WIDTH, Qt::SolidLine, Qt::RoundCap, Qt::RoundJoin));
+    painter.drawLine(from, to);
+
+    QRect segment = QRect(from, to).normalized().adjusted(-PEN_WIDTH, -PEN_WIDTH, PEN_WIDTH, PEN_WIDTH);
+    drawnBounds = drawnBounds.united(segment.intersected(image.rect()));
+    return segment;
+}
+
+void PaintOnImg::captureTiles(Stroke &stroke, const QRect &area) const {
+    QRect clipped = area.intersected(image.rect());
+    if (clipped.isEmpty()) {
+        return;
+    }
+    for (int ty = clipped.top() / TILE_SIZE; ty <= clipped.bottom() / TILE_SIZE; ++ty) {
+        for (int tx = clipped.left() / TILE_SIZE; tx <= clipped.right() / TILE_SIZE; ++tx) {
+            quint32 key = (static_cast<quint32>(ty) << 16) | static_cast<quint32>(tx);
+            if (!stroke.tilesBefore.contains(key)) {
+                stroke.tilesBefore.insert(key, image.copy(tileRect(key)));
+            }
+        }
+    }
+}
+
+QRect PaintOnImg::tileRect(quint32 key) const {
+    int tx = static_cast<int>(key & 0xffff);
+    int ty = static_cast<int>(key >> 16);
+    return QRect(tx * TILE_SIZE, ty * TILE_SIZE, TILE_SIZE, TILE_SIZE).intersected(image.rect());
+}
+
+QRect PaintOnImg::restoreTiles(const Stroke &stroke) {
+    QRect restored;
+    QPainter painter(&image);
+    painter.setCompositionMode(QPainter::CompositionMode_Source);
+    for (auto it = stroke.tilesBefore.cbegin(); it != stroke.tilesBefore.cend(); ++it) {
+        QRect rect = tileRect(it.key());
+        painter.drawImage(rect.topLeft(), it.value());
+        restored = restored.united(rect);
+    }
+    return restored;
+}
+
+QRect PaintOnImg::replay(const Stroke &stroke) {
+    if (stroke.points.isEmpty()) {
+        image.fill(Qt::transparent);
+        return image.rect();
+    }
+    QRect drawn;
+    for (int i = 1; i < stroke.points.size(); ++i) {
+        drawn = drawn.united(drawSegment(stroke.points[i - 1], stroke.points[i], stroke.color));
+    }
+    return drawn;
 }
 
 void PaintOnImg::undo() {
     if (!undoStack.isEmpty()) {
-        redoStack.push(QPixmap::fromImage(image));
-        image = undoStack.pop().toImage();
-        update();
+        Stroke stroke = undoStack.pop();
+        QRect changed = restoreTiles(stroke);
+        redoStack.push(stroke);
+        update(changed);
+        markDirty(changed);
+        flushDirty();
     }
 }
 
 void PaintOnImg::redo() {
     if (!redoStack.isEmpty()) {
-        undoStack.push(QPixmap::fromImage(image));
-        image = redoStack.pop().toImage();
-        update();
+        // Undo left the tiles exactly as they were, so replaying the stroke is exact too
+        Stroke stroke = redoStack.pop();
+        QRect changed = replay(stroke);
+        undoStack.push(stroke);
+        update(changed);
+        markDirty(changed);
+        flushDirty();
     }
 }
 
@@ -101,8 +163,34 @@ void PaintOnImg::setDrawingColor(const QColor &color) {
 }
 
 void PaintOnImg::clearDrawing() {
-    saveStateToUndo();
+    Stroke clear; // No points: replays as a fill
+    captureTiles(clear, drawnBounds);
+    undoStack.push(clear);
+    redoStack.clear();
+
     image.fill(Qt::transparent); // Clear the drawing
-    update();
+    update(drawnBounds);
+    markDirty(drawnBounds);
+    flushDirty();
     qDebug() << "Drawing cleared";
 }
+
+void PaintOnImg::markDirty(const QRect &rect) {
+    QRect clipped = rect.intersected(image.rect());
+    if (clipped.isEmpty()) {
+        return;
+    }
+    // Whole tiles, so the model copies a few aligned blocks
+    QRect aligned(QPoint(clipped.left() / TILE_SIZE * TILE_SIZE, clipped.top() / TILE_SIZE * TILE_SIZE),
+                  QPoint((clipped.right() / TILE_SIZE + 1) * TILE_SIZE - 1, (clipped.bottom() / TILE_SIZE + 1) * TILE_SIZE - 1));
+    pendingDirty = pendingDirty.united(aligned.intersected(image.rect()));
+}
+
+void PaintOnImg::flushDirty() {
+    if (pendingDirty.isEmpty()) {
+        return;
+    }
+    QRect dirty = pendingDirty;
+    pendingDirty = QRect();
+    emit drawingChanged(image, dirty);
+}
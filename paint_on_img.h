@@ -6,10 +6,15 @@
 #include <QMouseEvent>
 #include <QPainter>
 #include <QStack>
-#include <QPixmap>
+#include <QHash>
+#include <QVector>
 #include <QColor>
 #include <QContextMenuEvent>
 
+// Freehand drawing layer. History is kept as stroke commands: each undo step holds
+// the stroke's points and a copy of only the tiles it touched, taken before it was
+// drawn. Undo pastes those tiles back, redo replays the stroke, so memory grows with
+// the area drawn rather than by a full canvas per stroke.
 class PaintOnImg : public QWidget {
     Q_OBJECT
 
@@ -27,6 +32,9 @@ public:
     void handleMouseMoveEvent(QMouseEvent *event);
     void handleMouseReleaseEvent(QMouseEvent *event);
 
+signals:
+    // Emitted after each stroke, undo, redo or clear; dirty is tile-aligned
+    void drawingChanged(const QImage &drawing, const QRect &dirty);
 
 protected:
     void paintEvent(QPaintEvent *event) override;
@@ -38,16 +46,34 @@ protected:
 
 
 private:
+    static const int TILE_SIZE = 128;
+    static const int PEN_WIDTH = 2;
+
+    struct Stroke {
+        QVector<QPoint> points;             // Empty for a clear
+        QColor color;
+        QHash<quint32, QImage> tilesBefore; // Key is ty << 16 | tx
+    };
+
     QImage image;
     bool drawing;
     QPoint lastPoint;
 
-    QStack<QPixmap> undoStack;
-    QStack<QPixmap> redoStack;
+    QStack<Stroke> undoStack;
+    QStack<Stroke> redoStack;
+    Stroke currentStroke;
 
     QColor drawingColor;
+    QRect drawnBounds;  // Everything ever drawn; what a clear has to save
+    QRect pendingDirty; // Changed since the last drawingChanged
 
-    void saveStateToUndo();
+    QRect drawSegment(const QPoint &from, const QPoint &to, const QColor &color);
+    void captureTiles(Stroke &stroke, const QRect &area) const;
+    QRect tileRect(quint32 key) const;
+    QRect restoreTiles(const Stroke &stroke);
+    QRect replay(const Stroke &stroke);
+    void markDirty(const QRect &rect);
+    void flushDirty();
 };
 
 #endif // PAINT_ON_IMG_H
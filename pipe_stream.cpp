@@ -0,0 +1,429 @@
+#include "pipe_stream.h"
+#include <QCoreApplication>
+#include <QPluginLoader>
+#include <QDebug>
+#include <cuda_runtime.h>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#endif
+
+static const char *Y4M_MAGIC = "YUV4MPEG2";
+static const size_t STREAM_BUFFER_SIZE = 1 << 22;
+
+PipeStreamer::PipeStreamer(const PipeOptions &options)
+    : options(options), input(nullptr), output(nullptr),
+    chroma(Chroma::C420), interlaceTag("Ip"), aspectTag("A1:1"),
+    colorEnhancement(nullptr), useGpu(false), frameCount(0)
+{
+}
+
+PipeStreamer::~PipeStreamer()
+{
+    if (input && input != stdin) {
+        fclose(input);
+    }
+    if (output && output != stdout) {
+        fclose(output);
+    }
+}
+
+bool PipeStreamer::isPipeInvocation(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--pipe") == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+QString PipeStreamer::usage()
+{
+    return "Usage: imaging_instruments --pipe <instrument[,instrument...]> "
+           "[--input <file|pipe|->] [--output <file|pipe|->] [--raw <W>x<H>] [--fps <num[:den]>]\n"
+           "Instruments: vmf, clahe, histeq, sobel, blur, deblur\n"
+           "Input is YUV4MPEG2 unless --raw is given (BGR24); output is always YUV4MPEG2.\n";
+}
+
+bool PipeStreamer::parseArguments(const QStringList &arguments, PipeOptions &options, QString &error)
+{
+    const QStringList known = {"vmf", "clahe", "histeq", "sobel", "blur", "deblur"};
+
+    for (int i = 1; i < arguments.size(); ++i) {
+        const QString &arg = arguments.at(i);
+        bool hasValue = i + 1 < arguments.size();
+
+        if (arg == "--pipe" && hasValue) {
+            options.chain = arguments.at(++i).toLower().split(',', Qt::SkipEmptyParts);
+        } else if (arg == "--input" && hasValue) {
+            options.inputPath = arguments.at(++i);
+        } else if (arg == "--output" && hasValue) {
+            options.outputPath = arguments.at(++i);
+        } else if (arg == "--raw" && hasValue) {
+            QStringList size = arguments.at(++i).toLower().split('x');
+            if (size.size() != 2) {
+                error = "Invalid --raw size, expected <W>x<H>.";
+                return false;
+            }
+            options.rawInput = true;
+            options.width = size.at(0).toInt();
+            options.height = size.at(1).toInt();
+        } else if (arg == "--fps" && hasValue) {
+            QStringList rate = arguments.at(++i).split(':');
+            options.fpsNum = rate.at(0).toInt();
+            options.fpsDen = rate.size() > 1 ? rate.at(1).toInt() : 1;
+        } else {
+            error = "Unknown or incomplete argument: " + arg;
+            return false;
+        }
+    }
+
+    if (options.chain.isEmpty()) {
+        error = "No instruments given to --pipe.";
+        return false;
+    }
+    for (const QString &name : options.chain) {
+        if (!known.contains(name)) {
+            error = "Unknown instrument: " + name;
+            return false;
+        }
+    }
+    if (options.rawInput && (options.width <= 0 || options.height <= 0)) {
+        error = "Raw input needs a positive frame size.";
+        return false;
+    }
+    if (options.fpsNum <= 0 || options.fpsDen <= 0) {
+        error = "Invalid frame rate.";
+        return false;
+    }
+    return true;
+}
+
+int PipeStreamer::run()
+{
+    if (!openStreams() || !readHeader()) {
+        return 1;
+    }
+
+    // Raw BGR input is written out as 4:2:0 too
+    bool subsampled = chroma == Chroma::C420 || chroma == Chroma::BGR24;
+    if (subsampled && (options.width % 2 != 0 || options.height % 2 != 0)) {
+        fprintf(stderr, "pipe: 4:2:0 output needs even frame dimensions.\n");
+        return 1;
+    }
+
+    allocateBuffers();
+
+    if ((options.chain.contains("clahe") || options.chain.contains("histeq")) && !loadColorEnhancement()) {
+        return 1;
+    }
+    if (options.chain.contains("vmf")) {
+        int deviceCount = 0;
+        useGpu = cudaGetDeviceCount(&deviceCount) == cudaSuccess && deviceCount > 0;
+    }
+
+    if (!writeHeader()) {
+        return 1;
+    }
+
+    while (readFrame()) {
+        if (!applyChain()) {
+            fprintf(stderr, "pipe: instrument chain failed on frame %lld.\n", frameCount);
+            return 1;
+        }
+        if (!writeFrame()) {
+            fprintf(stderr, "pipe: could not write frame %lld.\n", frameCount);
+            return 1;
+        }
+        ++frameCount;
+    }
+
+    fflush(output);
+    fprintf(stderr, "pipe: %lld frames processed with %s (%s).\n", frameCount,
+            options.chain.join(",").toLocal8Bit().constData(), useGpu ? "GPU" : "CPU");
+    return 0;
+}
+
+bool PipeStreamer::openStreams()
+{
+    if (options.inputPath == "-") {
+        input = stdin;
+    } else {
+        // Named pipes (mkfifo on Linux, \\.\pipe\name on Windows) open like regular files
+        input = fopen(options.inputPath.toLocal8Bit().constData(), "rb");
+    }
+    if (options.outputPath == "-") {
+        output = stdout;
+    } else {
+        output = fopen(options.outputPath.toLocal8Bit().constData(), "wb");
+    }
+
+    if (!input || !output) {
+        fprintf(stderr, "pipe: could not open input or output stream.\n");
+        return false;
+    }
+
+#ifdef _WIN32
+    _setmode(_fileno(input), _O_BINARY);
+    _setmode(_fileno(output), _O_BINARY);
+#endif
+
+    // Large stdio buffers so each frame is moved with a handful of system calls
+    setvbuf(input, nullptr, _IOFBF, STREAM_BUFFER_SIZE);
+    setvbuf(output, nullptr, _IOFBF, STREAM_BUFFER_SIZE);
+    return true;
+}
+
+bool PipeStreamer::readFully(void *data, size_t bytes)
+{
+    char *dst = static_cast<char *>(data);
+    size_t done = 0;
+    while (done < bytes) {
+        size_t n = fread(dst + done, 1, bytes - done, input);
+        if (n == 0) {
+            return false;
+        }
+        done += n;
+    }
+    return true;
+}
+
+bool PipeStreamer::readLine(std::string &line)
+{
+    line.clear();
+    int c;
+    while ((c = fgetc(input)) != EOF) {
+        if (c == '\n') {
+            return true;
+        }
+        line.push_back(static_cast<char>(c));
+    }
+    return !line.empty();
+}
+
+bool PipeStreamer::readHeader()
+{
+    if (options.rawInput) {
+        chroma = Chroma::BGR24;
+        colorspaceTag = "C420jpeg";
+        return true;
+    }
+
+    std::string header;
+    if (!readLine(header) || header.compare(0, std::strlen(Y4M_MAGIC), Y4M_MAGIC) != 0) {
+        fprintf(stderr, "pipe: input is not a YUV4MPEG2 stream (use --raw for BGR24).\n");
+        return false;
+    }
+
+    std::string colorspace = "420jpeg";
+    std::istringstream tokens(header.substr(std::strlen(Y4M_MAGIC)));
+    std::string token;
+    try {
+        while (tokens >> token) {
+            switch (token[0]) {
+            case 'W': options.width = std::stoi(token.substr(1)); break;
+            case 'H': options.height = std::stoi(token.substr(1)); break;
+            case 'F': {
+                size_t colon = token.find(':');
+                if (colon != std::string::npos) {
+                    options.fpsNum = std::stoi(token.substr(1, colon - 1));
+                    options.fpsDen = std::stoi(token.substr(colon + 1));
+                }
+                break;
+            }
+            case 'I': interlaceTag = token; break;
+            case 'A': aspectTag = token; break;
+            case 'C': colorspace = token.substr(1); break;
+            default: break; // X parameters and unknown tags are ignored
+            }
+        }
+    } catch (const std::exception &) {
+        fprintf(stderr, "pipe: malformed Y4M header parameter '%s'.\n", token.c_str());
+        return false;
+    }
+
+    if (colorspace.compare(0, 3, "420") == 0) {
+        chroma = Chroma::C420;
+        colorspaceTag = "C" + colorspace;
+    } else if (colorspace == "444") {
+        chroma = Chroma::C444;
+        colorspaceTag = "C444";
+    } else if (colorspace == "mono") {
+        chroma = Chroma::Mono;
+        colorspaceTag = "Cmono";
+    } else {
+        fprintf(stderr, "pipe: unsupported Y4M colorspace C%s (8-bit 420, 444 and mono only).\n", colorspace.c_str());
+        return false;
+    }
+
+    if (options.width <= 0 || options.height <= 0) {
+        fprintf(stderr, "pipe: Y4M header has no frame size.\n");
+        return false;
+    }
+    return true;
+}
+
+void PipeStreamer::allocateBuffers()
+{
+    const int w = options.width;
+    const int h = options.height;
+
+    switch (chroma) {
+    case Chroma::BGR24:
+        inputBuffer.create(h, w, CV_8UC3);
+        outputBuffer.create(h * 3 / 2, w, CV_8UC1);
+        break;
+    case Chroma::C420:
+        inputBuffer.create(h * 3 / 2, w, CV_8UC1);
+        outputBuffer.create(h * 3 / 2, w, CV_8UC1);
+        break;
+    case Chroma::C444:
+        inputBuffer.create(h * 3, w, CV_8UC1);
+        outputBuffer.create(h * 3, w, CV_8UC1);
+        yuvPacked.create(h, w, CV_8UC3);
+        break;
+    case Chroma::Mono:
+        inputBuffer.create(h, w, CV_8UC1);
+        outputBuffer.create(h, w, CV_8UC1);
+        break;
+    }
+    frame.create(h, w, CV_8UC3);
+}
+
+bool PipeStreamer::writeHeader()
+{
+    fprintf(output, "%s W%d H%d F%d:%d %s %s %s\n", Y4M_MAGIC, options.width, options.height,
+            options.fpsNum, options.fpsDen, interlaceTag.c_str(), aspectTag.c_str(), colorspaceTag.c_str());
+    return !ferror(output);
+}
+
+bool PipeStreamer::readFrame()
+{
+    if (chroma == Chroma::BGR24) {
+        if (!readFully(inputBuffer.data, inputBuffer.total() * inputBuffer.elemSize())) {
+            return false;
+        }
+        frame = inputBuffer; // Raw BGR frames are processed straight from the read buffer
+        return true;
+    }
+
+    std::string frameHeader;
+    if (!readLine(frameHeader)) {
+        return false; // Clean end of stream
+    }
+    if (frameHeader.compare(0, 5, "FRAME") != 0) {
+        fprintf(stderr, "pipe: corrupt stream, expected FRAME header.\n");
+        return false;
+    }
+    if (!readFully(inputBuffer.data, inputBuffer.total())) {
+        fprintf(stderr, "pipe: truncated frame at end of stream.\n");
+        return false;
+    }
+
+    const int h = options.height;
+    switch (chroma) {
+    case Chroma::C420:
+        cv::cvtColor(inputBuffer, frame, cv::COLOR_YUV2BGR_I420);
+        break;
+    case Chroma::C444: {
+        // BT.601 limited range, matching the 4:2:0 conversions above
+        static const cv::Matx34f yuvToBgr(
+            1.164f,  2.018f,  0.000f, -1.164f * 16 - 2.018f * 128,
+            1.164f, -0.391f, -0.813f, -1.164f * 16 + 0.391f * 128 + 0.813f * 128,
+            1.164f,  0.000f,  1.596f, -1.164f * 16 - 1.596f * 128);
+        cv::Mat yuvPlanes[3] = { inputBuffer.rowRange(0, h), inputBuffer.rowRange(h, 2 * h), inputBuffer.rowRange(2 * h, 3 * h) };
+        cv::merge(yuvPlanes, 3, yuvPacked);
+        cv::transform(yuvPacked, frame, yuvToBgr);
+        break;
+    }
+    case Chroma::Mono:
+        cv::cvtColor(inputBuffer, frame, cv::COLOR_GRAY2BGR);
+        break;
+    case Chroma::BGR24:
+        break;
+    }
+    return true;
+}
+
+bool PipeStreamer::writeFrame()
+{
+    const int h = options.height;
+    switch (chroma) {
+    case Chroma::BGR24:
+    case Chroma::C420:
+        cv::cvtColor(frame, outputBuffer, cv::COLOR_BGR2YUV_I420);
+        break;
+    case Chroma::C444: {
+        static const cv::Matx34f bgrToYuv(
+             0.098f,  0.504f,  0.257f,  16.0f,
+             0.439f, -0.291f, -0.148f, 128.0f,
+            -0.071f, -0.368f,  0.439f, 128.0f);
+        cv::transform(frame, yuvPacked, bgrToYuv);
+        // The plane views alias outputBuffer, so split writes straight into it
+        std::vector<cv::Mat> yuvPlanes = { outputBuffer.rowRange(0, h), outputBuffer.rowRange(h, 2 * h), outputBuffer.rowRange(2 * h, 3 * h) };
+        cv::split(yuvPacked, yuvPlanes);
+        break;
+    }
+    case Chroma::Mono:
+        cv::cvtColor(frame, outputBuffer, cv::COLOR_BGR2GRAY);
+        break;
+    }
+
+    fputs("FRAME\n", output);
+    size_t bytes = outputBuffer.total() * outputBuffer.elemSize();
+    return fwrite(outputBuffer.data, 1, bytes, output) == bytes;
+}
+
+bool PipeStreamer::loadColorEnhancement()
+{
+    QString pluginPath = QCoreApplication::applicationDirPath() + "/libs/color_enhancement";
+    QPluginLoader pluginLoader(pluginPath);
+    colorEnhancement = dynamic_cast<PluginInterfaceColorEnhancement*>(pluginLoader.instance());
+    if (!colorEnhancement) {
+        fprintf(stderr, "pipe: could not load the color enhancement plugin: %s\n",
+                pluginLoader.errorString().toLocal8Bit().constData());
+        return false;
+    }
+    return true;
+}
+
+bool PipeStreamer::applyChain()
+{
+    for (const QString &name : options.chain) {
+        if (name == "vmf") {
+            cv::Mat filtered;
+            if (!model.runVectorFilter(frame, filtered, useGpu)) {
+                return false;
+            }
+            frame = filtered;
+        } else if (name == "clahe" || name == "histeq") {
+            cv::Mat enhanced = frame.clone(); // The plugin rejects an empty output image
+            colorEnhancement->processImage(frame, enhanced, name == "clahe" ? "claheVideo" : "histEqLuma");
+            frame = enhanced;
+        } else {
+            model.setInputImage(frame); // frame may be the same buffer as last time, refilled
+            if (name == "sobel") {
+                model.applySobelEdgeDetection();
+                cv::cvtColor(model.outputImage, frame, cv::COLOR_GRAY2BGR);
+            } else if (name == "blur") {
+                model.applyBlur();
+                frame = model.outputImage; // The model works in BGR, like the stream
+            } else if (name == "deblur") {
+                model.applyDeBlur();
+                frame = model.outputImage;
+            }
+            model.outputImage.release(); // frame is the next op's input; it must not be written in place
+        }
+
+        if (frame.empty() || frame.type() != CV_8UC3) {
+            return false;
+        }
+    }
+    return true;
+}
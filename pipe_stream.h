@@ -0,0 +1,77 @@
+#ifndef PIPE_STREAM_H
+#define PIPE_STREAM_H
+
+#include <QString>
+#include <QStringList>
+#include <cstdio>
+
+#include <opencv2/opencv.hpp>
+
+#include "model.h"
+#include "plugin_interface.h"
+
+// Options for the headless streaming mode, e.g.
+//   ffmpeg -i in.mp4 -f yuv4mpegpipe - | imaging_instruments --pipe vmf | ffmpeg -i - out.mkv
+struct PipeOptions {
+    QStringList chain;          // Instruments applied in order: vmf, clahe, histeq, sobel, blur, deblur
+    QString inputPath = "-";    // "-" for stdin, otherwise a file or named pipe
+    QString outputPath = "-";   // "-" for stdout
+    bool rawInput = false;      // Raw BGR24 instead of YUV4MPEG2
+    int width = 0;              // Required for raw input
+    int height = 0;
+    int fpsNum = 30;
+    int fpsDen = 1;
+};
+
+// Reads raw BGR24 or YUV4MPEG2 frames, runs the instrument chain and writes Y4M.
+// Frames are read straight into preallocated cv::Mat buffers and written from
+// preallocated output buffers, so with an empty chain steady-state streaming does not
+// allocate. Instruments still return new images per frame.
+class PipeStreamer
+{
+public:
+    explicit PipeStreamer(const PipeOptions &options);
+    ~PipeStreamer();
+
+    int run(); // Process exit code
+
+    static bool isPipeInvocation(int argc, char *argv[]);
+    static bool parseArguments(const QStringList &arguments, PipeOptions &options, QString &error);
+    static QString usage();
+
+private:
+    enum class Chroma { C420, C444, Mono, BGR24 };
+
+    bool openStreams();
+    bool readHeader();
+    bool readFrame();
+    bool writeHeader();
+    bool writeFrame();
+    bool applyChain();
+    bool loadColorEnhancement();
+
+    bool readFully(void *data, size_t bytes);
+    bool readLine(std::string &line);
+    void allocateBuffers();
+
+    PipeOptions options;
+    FILE *input;
+    FILE *output;
+
+    Chroma chroma;
+    std::string colorspaceTag;
+    std::string interlaceTag;
+    std::string aspectTag;
+
+    cv::Mat inputBuffer;   // Raw bytes of one frame as read from the stream
+    cv::Mat outputBuffer;  // Raw bytes of one Y4M frame as written to the stream
+    cv::Mat frame;         // Working BGR frame passed through the chain
+    cv::Mat yuvPacked;     // Interleaved planes for the 4:4:4 conversions
+
+    ImagingInstrumentsModel model;
+    PluginInterfaceColorEnhancement *colorEnhancement;
+    bool useGpu;
+    long long frameCount;
+};
+
+#endif // PIPE_STREAM_H
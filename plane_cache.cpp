@@ -0,0 +1,53 @@
+#include "plane_cache.h"
+
+void PlaneCache::invalidate()
+{
+    source.release();
+    grayPlane.release();
+    floatPlane.release();
+    binaryPlane = BinaryImage();
+    binaryChecked = false;
+}
+
+void PlaneCache::select(const cv::Mat &image)
+{
+    bool same = source.data == image.data && source.size == image.size
+                && source.type() == image.type() && source.step[0] == image.step[0];
+    if (!same) {
+        invalidate();
+        source = image;
+    }
+}
+
+const cv::Mat &PlaneCache::gray(const cv::Mat &image)
+{
+    select(image);
+    if (grayPlane.empty()) {
+        if (image.channels() == 1) {
+            grayPlane = image;
+        } else {
+            cv::cvtColor(image, grayPlane, image.channels() == 4 ? cv::COLOR_BGRA2GRAY : cv::COLOR_BGR2GRAY);
+        }
+    }
+    return grayPlane;
+}
+
+const cv::Mat &PlaneCache::unitFloat(const cv::Mat &image)
+{
+    select(image);
+    if (floatPlane.empty()) {
+        double scale = image.depth() == CV_8U ? 1.0 / 255.0 : (image.depth() == CV_16U ? 1.0 / 65535.0 : 1.0);
+        image.convertTo(floatPlane, CV_MAKETYPE(CV_32F, image.channels()), scale);
+    }
+    return floatPlane;
+}
+
+const BinaryImage *PlaneCache::binary(const cv::Mat &image)
+{
+    const cv::Mat &plane = gray(image);
+    if (!binaryChecked) {
+        binaryPlane.pack(plane);
+        binaryChecked = true;
+    }
+    return binaryPlane.empty() ? nullptr : &binaryPlane;
+}
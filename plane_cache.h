@@ -0,0 +1,32 @@
+#ifndef PLANE_CACHE_H
+#define PLANE_CACHE_H
+
+#include <opencv2/opencv.hpp>
+
+#include "binary_image.h"
+
+// Planes derived from one BGR (or single-channel) image, each computed on first
+// use and kept until a different image is asked for. The cache holds a reference to
+// its source, so the buffer cannot be freed and reused by another image at the same
+// address while an entry is alive; writes into the source itself need invalidate().
+// Returned planes are shared, so callers must treat them as read-only.
+class PlaneCache
+{
+public:
+    void invalidate();
+
+    const cv::Mat &gray(const cv::Mat &image);       // 8-bit; the image itself when it has one channel
+    const cv::Mat &unitFloat(const cv::Mat &image);  // CV_32F scaled to [0, 1], same channel count
+    const BinaryImage *binary(const cv::Mat &image); // Packed gray plane; nullptr unless all 0 or 255
+
+private:
+    void select(const cv::Mat &image); // Drops every plane unless image is the cached source
+
+    cv::Mat source;
+    cv::Mat grayPlane;
+    cv::Mat floatPlane;
+    BinaryImage binaryPlane;
+    bool binaryChecked = false; // The verdict is kept too, so gray images are scanned once
+};
+
+#endif // PLANE_CACHE_H
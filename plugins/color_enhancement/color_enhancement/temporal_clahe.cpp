@@ -0,0 +1,193 @@
+#include "temporal_clahe.h"
+#include <opencv2/core/utility.hpp>
+#include <algorithm>
+
+TemporalClahe::TemporalClahe()
+    : clipLimit(2.0), requestedGrid(8, 8), grid(8, 8), updateInterval(4), sampleStride(2), smoothing(0.25),
+    hasLuts(false), frameCounter(0)
+{
+}
+
+void TemporalClahe::setClipLimit(double limit)
+{
+    clipLimit = std::max(1.0, limit);
+}
+
+void TemporalClahe::setTileGrid(cv::Size newGrid)
+{
+    newGrid = cv::Size(std::max(1, newGrid.width), std::max(1, newGrid.height));
+    if (newGrid != requestedGrid) {
+        requestedGrid = newGrid;
+        frameSize = cv::Size(); // Rebuild the geometry and LUTs on the next frame
+    }
+}
+
+void TemporalClahe::setUpdateInterval(int frames)
+{
+    updateInterval = std::max(1, frames);
+}
+
+void TemporalClahe::setSampleStride(int stride)
+{
+    sampleStride = std::max(1, stride);
+}
+
+void TemporalClahe::setSmoothing(double alpha)
+{
+    smoothing = std::min(1.0, std::max(0.01, alpha));
+}
+
+void TemporalClahe::reset()
+{
+    hasLuts = false;
+    frameCounter = 0;
+}
+
+static void interpolationTable(int length, int tiles, std::vector<int> &starts,
+                               std::vector<int> &cell, std::vector<float> &weight)
+{
+    starts.resize(tiles + 1);
+    for (int t = 0; t <= tiles; ++t) {
+        starts[t] = static_cast<int>(static_cast<long long>(t) * length / tiles);
+    }
+
+    std::vector<float> centers(tiles);
+    for (int t = 0; t < tiles; ++t) {
+        centers[t] = 0.5f * (starts[t] + starts[t + 1] - 1);
+    }
+
+    // Before the first and after the last center the nearest tile is used alone
+    cell.resize(length);
+    weight.resize(length);
+    int t = 0;
+    for (int i = 0; i < length; ++i) {
+        while (t + 1 < tiles && i >= centers[t + 1]) {
+            ++t;
+        }
+        cell[i] = t;
+        if (t + 1 < tiles && i >= centers[t]) {
+            weight[i] = (i - centers[t]) / (centers[t + 1] - centers[t]);
+        } else {
+            weight[i] = 0.0f;
+        }
+    }
+}
+
+void TemporalClahe::prepareGeometry(cv::Size size)
+{
+    frameSize = size;
+    grid = cv::Size(std::min(requestedGrid.width, size.width), std::min(requestedGrid.height, size.height));
+    interpolationTable(size.width, grid.width, tileX0, columnTile, columnWeight);
+    interpolationTable(size.height, grid.height, tileY0, rowTile, rowWeight);
+
+    luts.assign(static_cast<size_t>(grid.area()) * 256, 0.0f);
+    freshLuts.assign(luts.size(), 0.0f);
+    reset();
+}
+
+void TemporalClahe::updateLuts(const cv::Mat &plane)
+{
+    const int stride = sampleStride;
+
+    cv::parallel_for_(cv::Range(0, grid.area()), [&](const cv::Range &range) {
+        for (int tile = range.start; tile < range.end; ++tile) {
+            const int tx = tile % grid.width;
+            const int ty = tile / grid.width;
+
+            int hist[256] = {};
+            int samples = 0;
+            for (int y = tileY0[ty]; y < tileY0[ty + 1]; y += stride) {
+                const uchar *row = plane.ptr<uchar>(y);
+                for (int x = tileX0[tx]; x < tileX0[tx + 1]; x += stride) {
+                    ++hist[row[x]];
+                    ++samples;
+                }
+            }
+            samples = std::max(1, samples);
+
+            // Clip and redistribute the excess evenly, as cv::CLAHE does
+            const int clip = std::max(1, static_cast<int>(clipLimit * samples / 256));
+            int excess = 0;
+            for (int v = 0; v < 256; ++v) {
+                if (hist[v] > clip) {
+                    excess += hist[v] - clip;
+                    hist[v] = clip;
+                }
+            }
+            const int batch = excess / 256;
+            int residual = excess - batch * 256;
+            for (int v = 0; v < 256; ++v) {
+                hist[v] += batch;
+            }
+            if (residual > 0) {
+                const int step = std::max(256 / residual, 1);
+                for (int v = 0; v < 256 && residual > 0; v += step, --residual) {
+                    ++hist[v];
+                }
+            }
+
+            const float scale = 255.0f / samples;
+            float *lut = freshLuts.data() + static_cast<size_t>(tile) * 256;
+            int sum = 0;
+            for (int v = 0; v < 256; ++v) {
+                sum += hist[v];
+                lut[v] = std::min(255.0f, sum * scale);
+            }
+        }
+    });
+
+    if (!hasLuts || smoothing >= 1.0) {
+        luts = freshLuts;
+        hasLuts = true;
+        return;
+    }
+    const float alpha = static_cast<float>(smoothing);
+    for (size_t i = 0; i < luts.size(); ++i) {
+        luts[i] += alpha * (freshLuts[i] - luts[i]);
+    }
+}
+
+bool TemporalClahe::apply(const cv::Mat &plane, cv::Mat &output)
+{
+    if (plane.empty() || plane.type() != CV_8UC1) {
+        return false;
+    }
+
+    if (plane.size() != frameSize) {
+        prepareGeometry(plane.size());
+    }
+    if (!hasLuts || frameCounter % updateInterval == 0) {
+        updateLuts(plane);
+    }
+    ++frameCounter;
+
+    output.create(plane.size(), CV_8UC1);
+    const int cols = plane.cols;
+    const int gx = grid.width;
+    const int gy = grid.height;
+
+    // Bilinear blend of the four surrounding tile LUTs
+    cv::parallel_for_(cv::Range(0, plane.rows), [&](const cv::Range &rows) {
+        for (int y = rows.start; y < rows.end; ++y) {
+            const int ty = rowTile[y];
+            const int ty2 = std::min(ty + 1, gy - 1);
+            const float wy = rowWeight[y];
+            const float *top = luts.data() + static_cast<size_t>(ty) * gx * 256;
+            const float *bottom = luts.data() + static_cast<size_t>(ty2) * gx * 256;
+
+            const uchar *in = plane.ptr<uchar>(y);
+            uchar *out = output.ptr<uchar>(y);
+            for (int x = 0; x < cols; ++x) {
+                const int tx = columnTile[x];
+                const int tx2 = std::min(tx + 1, gx - 1);
+                const float wx = columnWeight[x];
+                const int v = in[x];
+
+                float upper = top[tx * 256 + v] + (top[tx2 * 256 + v] - top[tx * 256 + v]) * wx;
+                float lower = bottom[tx * 256 + v] + (bottom[tx2 * 256 + v] - bottom[tx * 256 + v]) * wx;
+                out[x] = cv::saturate_cast<uchar>(upper + (lower - upper) * wy);
+            }
+        }
+    });
+    return true;
+}
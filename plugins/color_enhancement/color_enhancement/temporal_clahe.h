@@ -0,0 +1,51 @@
+#ifndef TEMPORAL_CLAHE_H
+#define TEMPORAL_CLAHE_H
+
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+// CLAHE for video. The tile grid, interpolation tables and per-tile LUTs survive
+// between frames. Tile histograms are taken on a sampled grid and only every N-th
+// frame; new LUTs are blended into the previous ones so the contrast mapping does
+// not flicker. On the frames in between, enhancement is one interpolated LUT
+// lookup per pixel.
+class TemporalClahe
+{
+public:
+    TemporalClahe();
+
+    void setClipLimit(double limit);
+    void setTileGrid(cv::Size grid);
+    void setUpdateInterval(int frames);   // Recompute tile histograms every N frames
+    void setSampleStride(int stride);     // Histogram every n-th row and column of a tile
+    void setSmoothing(double alpha);      // Weight of the new LUTs, 1 disables temporal blending
+
+    void reset();
+    bool apply(const cv::Mat &plane, cv::Mat &output); // 8-bit single channel
+
+private:
+    void prepareGeometry(cv::Size size);
+    void updateLuts(const cv::Mat &plane);
+
+    double clipLimit;
+    cv::Size requestedGrid;
+    cv::Size grid;                            // Requested grid, limited to the frame size
+    int updateInterval;
+    int sampleStride;
+    double smoothing;
+
+    cv::Size frameSize;
+    std::vector<int> tileX0, tileY0;          // First column/row of each tile, plus the end
+    std::vector<int> columnTile;              // Left tile of the interpolation cell for each column
+    std::vector<float> columnWeight;          // Weight of the right tile
+    std::vector<int> rowTile;
+    std::vector<float> rowWeight;
+
+    std::vector<float> luts;                  // grid.area() x 256, temporally blended
+    std::vector<float> freshLuts;
+    bool hasLuts;
+    long long frameCounter;
+};
+
+#endif // TEMPORAL_CLAHE_H
@@ -1,13 +1,12 @@
 #include "impulse_noise.h"
 #include <opencv2/imgproc.hpp>
 #include <opencv2/core.hpp>
-#include <cstdlib>  // For std::rand and std::srand
+#include <cmath>
 #include <ctime>    // For std::time
 
 Impulse_noise::Impulse_noise()
+    : noiseSeed(static_cast<quint64>(std::time(0))) // A different pattern per run unless a seed is set
 {
-    // Initialize random seed
-    std::srand(std::time(0));
 }
 
 Impulse_noise::~Impulse_noise()
@@ -37,22 +36,26 @@ void Impulse_noise::addSaltAndPepperNoise(cv::Mat &image, float saltPepperRatio)
         throw std::invalid_argument("saltPepperRatio should be between 0 and 1.");
     }
 
-    // Number of pixels to alter
-    int totalPixels = image.rows * image.cols;
-    int numSaltPepperPixels = static_cast<int>(totalPixels * saltPepperRatio);
-
-    // Loop through and apply noise
-    for (int i = 0; i < numSaltPepperPixels; ++i) {
-        int x = std::rand() % image.cols;
-        int y = std::rand() % image.rows;
-
-        // Decide between salt and pepper
-        if (std::rand() % 2 == 0) {
-            // Salt (white)
-            image.at<cv::Vec3b>(y, x) = cv::Vec3b(255, 255, 255); // For color image
-        } else {
-            // Pepper (black)
-            image.at<cv::Vec3b>(y, x) = cv::Vec3b(0, 0, 0); // For color image
+    // The old generator hit totalPixels * ratio random positions with replacement. A given
+    // pixel is hit at least once with probability 1 - (1 - 1/N)^M, which we now draw per
+    // pixel from its own (seed, row, col) counter so rows can be generated in parallel.
+    const double totalPixels = static_cast<double>(image.rows) * image.cols;
+    if (totalPixels <= 0.0) return;
+    const double draws = std::floor(totalPixels * saltPepperRatio);
+    const double hitProbability = -std::expm1(draws * std::log1p(-1.0 / totalPixels));
+    const uint64_t threshold = static_cast<uint64_t>(hitProbability * 4294967296.0);
+
+    Philox4x32 rng(noiseSeed);
+
+    #pragma omp parallel for schedule(static)
+    for (int y = 0; y < image.rows; ++y) {
+        cv::Vec3b *row = image.ptr<cv::Vec3b>(y); // For color image
+        for (int x = 0; x < image.cols; ++x) {
+            Philox4x32::Block block = rng(static_cast<uint32_t>(y), static_cast<uint32_t>(x));
+            if (block.v[0] < threshold) {
+                // Decide between salt (white) and pepper (black)
+                row[x] = (block.v[1] & 1u) ? cv::Vec3b(0, 0, 0) : cv::Vec3b(255, 255, 255);
+            }
         }
     }
 }
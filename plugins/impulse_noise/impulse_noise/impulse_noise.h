@@ -3,19 +3,25 @@
 
 #include "impulse_noise_global.h"
 #include "cvplugininterface.h"
+#include "philox.h"
 
 class IMPULSE_NOISE_EXPORT Impulse_noise : public QObject, public CvPluginInterface {
     Q_OBJECT
     Q_PLUGIN_METADATA(IID CVPLUGININTERFACE_IID)
     Q_INTERFACES(CvPluginInterface)
+    Q_PROPERTY(quint64 seed READ seed WRITE setSeed)
 
 public:
     Impulse_noise();
     ~Impulse_noise();
+    quint64 seed() const { return noiseSeed; }
+    void setSeed(quint64 seed) { noiseSeed = seed; }
     QString description() override;
     void processImage(const cv::Mat &inputImage, cv::Mat &outputImage) override;
 private:
     void addSaltAndPepperNoise(cv::Mat &image, float saltPepperRatio = 0.5);
+
+    quint64 noiseSeed;
 };
 
 #endif
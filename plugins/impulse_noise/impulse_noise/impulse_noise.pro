@@ -13,12 +13,16 @@ TARGET = impulse_noise_plugin
 # Include directories for OpenCV
 INCLUDEPATH += /usr/include/opencv4
 
+# OpenMP for the per-row noise generation
+QMAKE_CXXFLAGS += -fopenmp
+QMAKE_LFLAGS += -fopenmp
+
 # Source and header files
 HEADERS += \
     cvplugininterface.h \
     impulse_noise_global.h \
     impulse_noise.h \
-    cvplugininterface.h
+    philox.h
 
 SOURCES += \
     impulse_noise.cpp
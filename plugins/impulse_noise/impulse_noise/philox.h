@@ -0,0 +1,56 @@
+#ifndef PHILOX_H
+#define PHILOX_H
+
+#include <cstdint>
+
+// Philox4x32-10 counter-based generator (Salmon et al., "Parallel Random
+// Numbers: As Easy as 1, 2, 3", SC'11). Every call is a pure function of
+// (key, counter), so each pixel can draw its own numbers from (seed, row, col)
+// with no shared state: rows can run on any thread, in any order, and the
+// result for a given seed is bit-identical regardless of thread count.
+class Philox4x32
+{
+public:
+    struct Block {
+        uint32_t v[4];
+    };
+
+    explicit Philox4x32(uint64_t seed = 0)
+        : key0(static_cast<uint32_t>(seed)), key1(static_cast<uint32_t>(seed >> 32)) {}
+
+    // Four independent 32-bit words for one (row, col, stream) counter
+    inline Block operator()(uint32_t row, uint32_t col, uint32_t stream = 0) const
+    {
+        uint32_t c0 = col, c1 = row, c2 = stream, c3 = 0;
+        uint32_t k0 = key0, k1 = key1;
+
+        for (int round = 0; round < 10; ++round) {
+            uint64_t p0 = static_cast<uint64_t>(M0) * c0;
+            uint64_t p1 = static_cast<uint64_t>(M1) * c2;
+            uint32_t n0 = static_cast<uint32_t>(p1 >> 32) ^ c1 ^ k0;
+            uint32_t n1 = static_cast<uint32_t>(p1);
+            uint32_t n2 = static_cast<uint32_t>(p0 >> 32) ^ c3 ^ k1;
+            uint32_t n3 = static_cast<uint32_t>(p0);
+            c0 = n0; c1 = n1; c2 = n2; c3 = n3;
+            k0 += W0;
+            k1 += W1;
+        }
+
+        Block block = {{ c0, c1, c2, c3 }};
+        return block;
+    }
+
+    // Uniform in [0, 1) with 32 bits of resolution
+    static inline double toUnit(uint32_t word) { return word * (1.0 / 4294967296.0); }
+
+private:
+    static const uint32_t M0 = 0xD2511F53u;
+    static const uint32_t M1 = 0xCD9E8D57u;
+    static const uint32_t W0 = 0x9E3779B9u; // Golden ratio
+    static const uint32_t W1 = 0xBB67AE85u; // sqrt(3) - 1
+
+    uint32_t key0;
+    uint32_t key1;
+};
+
+#endif // PHILOX_H
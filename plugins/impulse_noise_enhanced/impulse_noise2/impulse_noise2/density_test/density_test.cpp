@@ -0,0 +1,41 @@
+#include "impulse_noise2.h"
+#include <cmath>
+#include <cstdio>
+
+// Salt and pepper on a mid-gray 8-bit image: every hit turns a pixel to 0 or 255,
+// so the changed pixels are exactly the hits. Their count is Binomial(N, p); a hit
+// density outside p +- 5 standard deviations fails (about 1 in 1.7 million by chance).
+// The p values straddle the switch from the sparse to the dense path at 0.1.
+static bool checkDensity(ImpulseNoise &noise, const cv::Mat &input, double p)
+{
+    cv::Mat output;
+    noise.processImage(input, output, static_cast<float>(p));
+    const double n = static_cast<double>(input.total());
+    const double hits = static_cast<double>(cv::countNonZero(output != input));
+    // The plugin takes a float density
+    const double expected = n * static_cast<float>(p);
+    const double bound = 5.0 * std::sqrt(expected * (1.0 - static_cast<float>(p))) + 1.0;
+    const bool ok = std::fabs(hits - expected) <= bound;
+    std::printf("%s p=%-7g hits=%.0f expected=%.1f bound=%.1f\n", ok ? "ok  " : "FAIL", p, hits, expected, bound);
+    return ok;
+}
+
+int main()
+{
+    const double densities[] = { 0.0005, 0.001, 0.01, 0.05, 0.099, 0.0999, 0.1, 0.101, 0.2, 0.5 };
+
+    cv::Mat input(1999, 2000, CV_8UC1, cv::Scalar(128)); // Odd height, so rows split unevenly
+    ImpulseNoise noise;
+    noise.setNoiseTypeName("salt_pepper");
+
+    int failures = 0;
+    for (quint64 seed : { 1ull, 0x9e3779b97f4a7c15ull }) {
+        noise.setSeed(seed);
+        for (double p : densities) {
+            failures += checkDensity(noise, input, p) ? 0 : 1;
+        }
+    }
+
+    std::printf("%d failure(s)\n", failures);
+    return failures == 0 ? 0 : 1;
+}
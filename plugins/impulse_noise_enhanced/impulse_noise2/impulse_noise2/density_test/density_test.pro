@@ -0,0 +1,37 @@
+# Console check of the impulse injection density, built from the plugin source
+TEMPLATE = app
+CONFIG += console c++17
+CONFIG -= app_bundle
+
+QT += core
+
+win32: {
+    INCLUDEPATH += C:/opencv/opencv/build/include
+    LIBS += -LC:/opencv/opencv/build/x64/vc16/lib \
+            -lopencv_world490
+    QMAKE_CXXFLAGS += /openmp
+    QMAKE_LFLAGS += /openmp
+}
+
+linux: {
+    INCLUDEPATH += /usr/include/opencv4
+    LIBS += -L/usr/lib/x86_64-linux-gnu \
+            -lopencv_core -lopencv_imgproc
+    QMAKE_CXXFLAGS += -fopenmp
+    QMAKE_LFLAGS += -fopenmp
+}
+
+INCLUDEPATH += ..
+
+SOURCES += \
+    density_test.cpp \
+    ../impulse_noise2.cpp
+
+HEADERS += \
+    ../impulse_noise2_global.h \
+    ../impulse_noise2.h \
+    ../philox.h \
+    ../plugin_interface_noise.h
+
+# The plugin class is linked in directly, not imported from the library
+DEFINES += IMPULSE_NOISE_LIBRARY
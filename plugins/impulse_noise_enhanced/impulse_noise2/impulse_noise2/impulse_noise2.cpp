@@ -1,155 +1,451 @@
 #include "impulse_noise2.h"
+#include <QDebug>
 #include <opencv2/imgproc.hpp>
 #include <opencv2/core.hpp>
-#include <cstdlib>
-#include <ctime>
+#include <algorithm>
+#include <cmath>
 #include <random>
-#include <functional>
+#include <vector>
 
 
 
+// Counter streams, so the hit test and the impulse value never share random words
+static const uint32_t STREAM_HIT = 0;
+static const uint32_t STREAM_VALUE = 1;
+static const uint32_t STREAM_GAP = 2;
+static const uint32_t STREAM_GAUSSIAN = 3;
+static const uint32_t STREAM_SHOT = 4;
+static const uint32_t STREAM_SHOT_NORMAL = 5;
+
+// Above this mean, shot noise uses the normal approximation instead of CDF inversion
+static const double POISSON_INVERSION_LIMIT = 64.0;
+
+// Below this density, jumping between hits costs less than testing every pixel
+static const double SPARSE_DENSITY_LIMIT = 0.1;
+
+// Impulse values built from the four words of one Philox block.
+// Salt and pepper draws one bit per channel, random-value one uniform per channel.
+template <typename T> struct ImpulseValue;
+
+template <> struct ImpulseValue<uchar> {
+    static uchar saltAndPepper(const Philox4x32::Block &b) { return (b.v[0] & 1u) ? 255 : 0; }
+    static uchar randomValue(const Philox4x32::Block &b) { return static_cast<uchar>(b.v[0] >> 24); }
+};
+
+template <> struct ImpulseValue<float> {
+    static float saltAndPepper(const Philox4x32::Block &b) { return (b.v[0] & 1u) ? 0.0f : 1.0f; }
+    static float randomValue(const Philox4x32::Block &b) { return static_cast<float>(Philox4x32::toUnit(b.v[0])); }
+};
+
+template <> struct ImpulseValue<double> {
+    static double saltAndPepper(const Philox4x32::Block &b) { return (b.v[0] & 1u) ? 0.0 : 1.0; }
+    static double randomValue(const Philox4x32::Block &b) { return Philox4x32::toUnit(b.v[0]); }
+};
+
+template <typename E, int N> struct ImpulseValue<cv::Vec<E, N>> {
+    static cv::Vec<E, N> saltAndPepper(const Philox4x32::Block &b) {
+        cv::Vec<E, N> pixel;
+        for (int k = 0; k < N; ++k) {
+            Philox4x32::Block channel = {{ b.v[k % 4] >> (k / 4), 0, 0, 0 }};
+            pixel[k] = ImpulseValue<E>::saltAndPepper(channel);
+        }
+        return pixel;
+    }
+    static cv::Vec<E, N> randomValue(const Philox4x32::Block &b) {
+        cv::Vec<E, N> pixel;
+        for (int k = 0; k < N; ++k) {
+            Philox4x32::Block channel = {{ b.v[k % 4], 0, 0, 0 }};
+            pixel[k] = ImpulseValue<E>::randomValue(channel);
+        }
+        return pixel;
+    }
+};
+
 template <typename T>
-void addImpulseNoise(cv::Mat& image, double noiseRatio, NoiseType noiseType);
+inline void writeImpulse(T &pixel, uint32_t row, uint32_t col, NoiseType noiseType, const Philox4x32 &rng) {
+    Philox4x32::Block value = rng(row, col, STREAM_VALUE);
+    pixel = (noiseType == NoiseType::SALT_AND_PEPPER) ? ImpulseValue<T>::saltAndPepper(value)
+                                                      : ImpulseValue<T>::randomValue(value);
+}
 
+// Sparse path for small densities, O(p * N) instead of O(N). The gaps between hits
+// in a row of Bernoulli(p) trials are geometric, G = floor(ln U / ln(1 - p)), so we
+// jump from hit to hit. The k-th gap of row i uses counter (i, k), which keeps rows
+// independent and the result reproducible for a seed. The hit pattern has the same
+// distribution as the dense path, though not the same realization.
+template <typename T>
+void addSparseImpulseNoise(cv::Mat& image, double noiseRatio, NoiseType noiseType, const Philox4x32 &rng) {
+    const double logMiss = std::log1p(-noiseRatio);
+    const int rows = image.rows;
+    const int cols = image.cols;
+
+#pragma omp parallel for schedule(static)
+    for (int i = 0; i < rows; ++i) {
+        T *row = image.ptr<T>(i);
+        long long j = -1;
+        for (uint32_t k = 0;; ++k) {
+            // 53-bit uniform in (0, 1], so the logarithm is always finite
+            Philox4x32::Block block = rng(static_cast<uint32_t>(i), k, STREAM_GAP);
+            uint64_t bits = (static_cast<uint64_t>(block.v[0]) << 21) ^ (block.v[1] >> 11);
+            double u = (static_cast<double>(bits & ((1ull << 53) - 1)) + 1.0) * (1.0 / 9007199254740992.0);
+
+            double gap = std::floor(std::log(u) / logMiss);
+            if (gap >= static_cast<double>(cols - 1 - j)) break;
+
+            j += static_cast<long long>(gap) + 1;
+            writeImpulse(row[j], static_cast<uint32_t>(i), static_cast<uint32_t>(j), noiseType, rng);
+        }
+    }
+}
 
+// Every pixel draws from its own (seed, row, col) counter, so rows are independent:
+// they run in parallel and the output for a seed does not depend on the thread count.
 template <typename T>
-void applyNoise(cv::Mat& image, double noiseRatio, NoiseType noiseType,
-                std::function<T()> saltAndPepperFunc,
-                std::function<T()> randomValueFunc) {
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_real_distribution<> dis(0, 1);
-
-
-    //#pragma omp parallel for collapse(2) schedule(static)
-    for (int i = 0; i < image.rows; ++i) {
-        for (int j = 0; j < image.cols; ++j) {
-            if (dis(gen) < noiseRatio) {
-                if (noiseType == NoiseType::SALT_AND_PEPPER) {
-                    image.at<T>(i, j) = saltAndPepperFunc();
-                } else if (noiseType == NoiseType::RANDOM_VALUE) {
-                    image.at<T>(i, j) = randomValueFunc();
+void addImpulseNoise(cv::Mat& image, double noiseRatio, NoiseType noiseType, const Philox4x32 &rng) {
+    if (noiseRatio <= 0.0) return;
+    if (noiseRatio < SPARSE_DENSITY_LIMIT) {
+        addSparseImpulseNoise<T>(image, noiseRatio, noiseType, rng);
+        return;
+    }
+
+    // Compare raw 32-bit words against a fixed-point threshold instead of converting to double
+    const double scaled = std::min(1.0, std::max(0.0, noiseRatio)) * 4294967296.0;
+    const uint64_t threshold = static_cast<uint64_t>(scaled);
+    const int rows = image.rows;
+    const int cols = image.cols;
+
+#pragma omp parallel
+    {
+        std::vector<uint32_t> hits(cols);
+
+#pragma omp for schedule(static)
+        for (int i = 0; i < rows; ++i) {
+            // Branch-free pass over the row's hit words, which the compiler can vectorize
+            uint32_t *h = hits.data();
+#pragma omp simd
+            for (int j = 0; j < cols; ++j) {
+                h[j] = rng(static_cast<uint32_t>(i), static_cast<uint32_t>(j), STREAM_HIT).v[0];
+            }
+
+            T *row = image.ptr<T>(i);
+            for (int j = 0; j < cols; ++j) {
+                if (h[j] < threshold) {
+                    writeImpulse(row[j], static_cast<uint32_t>(i), static_cast<uint32_t>(j), noiseType, rng);
                 }
             }
         }
     }
 }
 
-// Specialization for uchar (8-bit grayscale images)
-template <>
-void addImpulseNoise<uchar>(cv::Mat& image, double noiseRatio, NoiseType noiseType) {
-    auto saltAndPepperFunc = []() -> uchar { return (rand() % 2) * 255; };
-    auto randomValueFunc = []() -> uchar { return static_cast<uchar>(rand() % 256); };
-
-    applyNoise(image, noiseRatio, noiseType,
-               static_cast<std::function<uchar()>>(saltAndPepperFunc),
-               static_cast<std::function<uchar()>>(randomValueFunc));
-}
 
-// Specialization for double (normalized grayscale images)
-template <>
-void addImpulseNoise<double>(cv::Mat& image, double noiseRatio, NoiseType noiseType) {
-    auto saltAndPepperFunc = []() -> double { return rand() % 2 ? 0.0 : 1.0; };
-    auto randomValueFunc = []() -> double { return static_cast<double>(rand()) / RAND_MAX; };
+// Additive models work on the channel values directly; 8-bit images span [0, 255],
+// floating-point ones [0, 1], matching the impulse values above
+template <typename E> inline double fullScale() { return 1.0; }
+template <> inline double fullScale<uchar>() { return 255.0; }
 
-    applyNoise(image, noiseRatio, noiseType,
-               static_cast<std::function<double()>>(saltAndPepperFunc),
-               static_cast<std::function<double()>>(randomValueFunc));
+template <typename E> inline E clampToRange(double value) {
+    return static_cast<E>(std::min(1.0, std::max(0.0, value)));
+}
+template <> inline uchar clampToRange<uchar>(double value) { return cv::saturate_cast<uchar>(value); }
+
+// Four standard normals from one block, two Box-Muller pairs
+static inline void gaussianQuad(const Philox4x32::Block &b, double z[4]) {
+    for (int p = 0; p < 2; ++p) {
+        double u1 = (b.v[2 * p] + 1.0) * (1.0 / 4294967296.0); // (0, 1], so the logarithm is finite
+        double u2 = Philox4x32::toUnit(b.v[2 * p + 1]);
+        double r = std::sqrt(-2.0 * std::log(u1));
+        z[2 * p] = r * std::cos(2.0 * CV_PI * u2);
+        z[2 * p + 1] = r * std::sin(2.0 * CV_PI * u2);
+    }
 }
 
-// Specialization for float (normalized grayscale images)
-template <>
-void addImpulseNoise<float>(cv::Mat& image, double noiseRatio, NoiseType noiseType) {
-    auto saltAndPepperFunc = []() -> float { return rand() % 2 ? 0.0f : 1.0f; };
-    auto randomValueFunc = []() -> float { return static_cast<float>(rand()) / RAND_MAX; };
+template <typename E>
+void addGaussianNoise(cv::Mat &image, double level, const Philox4x32 &rng) {
+    if (level <= 0.0) return;
+    const int cn = image.channels();
+    const double sigma = level * fullScale<E>();
+    const int rows = image.rows;
+    const int cols = image.cols;
+
+#pragma omp parallel for schedule(static)
+    for (int i = 0; i < rows; ++i) {
+        E *row = image.ptr<E>(i);
+        for (int j = 0; j < cols; ++j) {
+            double z[4];
+            gaussianQuad(rng(static_cast<uint32_t>(i), static_cast<uint32_t>(j), STREAM_GAUSSIAN), z);
+            E *pixel = row + j * cn;
+            for (int k = 0; k < cn; ++k) {
+                pixel[k] = clampToRange<E>(pixel[k] + sigma * z[k]);
+            }
+        }
+    }
+}
 
-    applyNoise(image, noiseRatio, noiseType,
-               static_cast<std::function<float()>>(saltAndPepperFunc),
-               static_cast<std::function<float()>>(randomValueFunc));
+// Poisson draw with mean lambda from one uniform by CDF inversion, or from a
+// standard normal once lambda is large enough for the normal approximation
+static inline double poissonSample(double lambda, double u, double z) {
+    if (lambda >= POISSON_INVERSION_LIMIT) {
+        return std::max(0.0, std::floor(lambda + std::sqrt(lambda) * z + 0.5));
+    }
+    double p = std::exp(-lambda);
+    double cdf = p;
+    int k = 0;
+    while (u > cdf && k < 4 * POISSON_INVERSION_LIMIT) {
+        ++k;
+        p *= lambda / k;
+        cdf += p;
+    }
+    return k;
 }
 
-// Specialization for cv::Vec3b (color images with uchar channels)
-template <>
-void addImpulseNoise<cv::Vec3b>(cv::Mat& image, double noiseRatio, NoiseType noiseType) {
-    auto saltAndPepperFunc = [&]() -> cv::Vec3b {
-        cv::Vec3b pixel;
-        for (int k = 0; k < 3; ++k) {
-            pixel[k] = (rand() % 2) * 255;
+// Shot noise: each value becomes a photon count with a matching mean. The level is the
+// relative noise of a full-scale value, so full scale collects 1 / level^2 photons and
+// darker values are relatively noisier, as on a real sensor.
+template <typename E>
+void addPoissonNoise(cv::Mat &image, double level, const Philox4x32 &rng) {
+    if (level <= 0.0) return;
+    const int cn = image.channels();
+    const double peak = 1.0 / (level * level);
+    const double toPhotons = peak / fullScale<E>();
+    const int rows = image.rows;
+    const int cols = image.cols;
+
+#pragma omp parallel for schedule(static)
+    for (int i = 0; i < rows; ++i) {
+        E *row = image.ptr<E>(i);
+        for (int j = 0; j < cols; ++j) {
+            Philox4x32::Block uniforms = rng(static_cast<uint32_t>(i), static_cast<uint32_t>(j), STREAM_SHOT);
+            double z[4];
+            bool haveNormals = false;
+            E *pixel = row + j * cn;
+            for (int k = 0; k < cn; ++k) {
+                double lambda = std::max(0.0, static_cast<double>(pixel[k])) * toPhotons;
+                if (lambda >= POISSON_INVERSION_LIMIT && !haveNormals) {
+                    gaussianQuad(rng(static_cast<uint32_t>(i), static_cast<uint32_t>(j), STREAM_SHOT_NORMAL), z);
+                    haveNormals = true;
+                }
+                double photons = poissonSample(lambda, Philox4x32::toUnit(uniforms.v[k]), haveNormals ? z[k] : 0.0);
+                pixel[k] = clampToRange<E>(photons / toPhotons);
+            }
         }
-        return pixel;
-    };
+    }
+}
+
 
-    auto randomValueFunc = [&]() -> cv::Vec3b {
-        cv::Vec3b pixel;
-        for (int k = 0; k < 3; ++k) {
-            pixel[k] = rand() % 256;
-        }
-        return pixel;
-    };
 
-    applyNoise(image, noiseRatio, noiseType,
-               static_cast<std::function<cv::Vec3b()>>(saltAndPepperFunc),
-               static_cast<std::function<cv::Vec3b()>>(randomValueFunc));
-}
 
-// Specialization for cv::Vec3d (color images with double channels)
-template <>
-void addImpulseNoise<cv::Vec3d>(cv::Mat& image, double noiseRatio, NoiseType noiseType) {
-    auto saltAndPepperFunc = [&]() -> cv::Vec3d {
-        cv::Vec3d pixel;
-        for (int k = 0; k < 3; ++k) {
-            pixel[k] = rand() % 2 ? 0.0 : 1.0;
+// Moves the output between two thresholds: pixels whose hit word lies in [from, to) get
+// their impulse when the density rises and their input value back when it falls.
+// Only the buckets spanning the range are visited, and only the two edge buckets need
+// their words recomputed. Returns the bounding box of the changed pixels.
+template <typename T>
+QRect updateMaskRange(const cv::Mat &input, cv::Mat &output, const std::vector<uint32_t> &order,
+                      const std::vector<uint32_t> &bucketStart, uint64_t from, uint64_t to,
+                      NoiseType noiseType, const Philox4x32 &rng) {
+    const bool adding = to > from;
+    const uint64_t lo = std::min(from, to);
+    const uint64_t hi = std::max(from, to);
+    if (lo == hi) return QRect();
+
+    const int firstBucket = static_cast<int>(lo >> 16);
+    const int lastBucket = static_cast<int>(std::min<uint64_t>((hi - 1) >> 16, 65535));
+    const int cols = input.cols;
+
+    int minX = cols, minY = input.rows, maxX = -1, maxY = -1;
+
+#pragma omp parallel
+    {
+        int tMinX = cols, tMinY = input.rows, tMaxX = -1, tMaxY = -1;
+
+#pragma omp for schedule(dynamic, 64)
+        for (int bucket = firstBucket; bucket <= lastBucket; ++bucket) {
+            const bool edge = (bucket == firstBucket) || (bucket == lastBucket);
+            for (uint32_t k = bucketStart[bucket]; k < bucketStart[bucket + 1]; ++k) {
+                const uint32_t index = order[k];
+                const int y = static_cast<int>(index / cols);
+                const int x = static_cast<int>(index % cols);
+
+                if (edge) {
+                    uint32_t word = rng(static_cast<uint32_t>(y), static_cast<uint32_t>(x), STREAM_HIT).v[0];
+                    if (word < lo || word >= hi) continue;
+                }
+
+                if (adding) {
+                    writeImpulse(output.ptr<T>(y)[x], static_cast<uint32_t>(y), static_cast<uint32_t>(x), noiseType, rng);
+                } else {
+                    output.ptr<T>(y)[x] = input.ptr<T>(y)[x];
+                }
+                tMinX = std::min(tMinX, x);
+                tMaxX = std::max(tMaxX, x);
+                tMinY = std::min(tMinY, y);
+                tMaxY = std::max(tMaxY, y);
+            }
         }
-        return pixel;
-    };
 
-    auto randomValueFunc = [&]() -> cv::Vec3d {
-        cv::Vec3d pixel;
-        for (int k = 0; k < 3; ++k) {
-            pixel[k] = static_cast<double>(rand()) / RAND_MAX;
+#pragma omp critical
+        {
+            minX = std::min(minX, tMinX);
+            maxX = std::max(maxX, tMaxX);
+            minY = std::min(minY, tMinY);
+            maxY = std::max(maxY, tMaxY);
         }
-        return pixel;
-    };
+    }
 
-    applyNoise(image, noiseRatio, noiseType,
-               static_cast<std::function<cv::Vec3d()>>(saltAndPepperFunc),
-               static_cast<std::function<cv::Vec3d()>>(randomValueFunc));
+    if (maxX < 0) return QRect();
+    return QRect(QPoint(minX, minY), QPoint(maxX, maxY));
 }
 
-// Specialization for cv::Vec3f (color images with float channels)
-template <>
-void addImpulseNoise<cv::Vec3f>(cv::Mat& image, double noiseRatio, NoiseType noiseType) {
-    auto saltAndPepperFunc = [&]() -> cv::Vec3f {
-        cv::Vec3f pixel;
-        for (int k = 0; k < 3; ++k) {
-            pixel[k] = rand() % 2 ? 0.0f : 1.0f;
-        }
-        return pixel;
-    };
+template <typename F>
+bool dispatchPixelType(int type, F &&f) {
+    switch (type) {
+    case CV_8UC1:  f(uchar()); return true;
+    case CV_32FC1: f(float()); return true;
+    case CV_64FC1: f(double()); return true;
+    case CV_8UC3:  f(cv::Vec3b()); return true;
+    case CV_32FC3: f(cv::Vec3f()); return true;
+    case CV_64FC3: f(cv::Vec3d()); return true;
+    }
+    return false;
+}
 
-    auto randomValueFunc = [&]() -> cv::Vec3f {
-        cv::Vec3f pixel;
-        for (int k = 0; k < 3; ++k) {
-            pixel[k] = static_cast<float>(rand()) / RAND_MAX;
-        }
-        return pixel;
-    };
+// Same dispatch on the channel type, for the additive models
+template <typename F>
+bool dispatchDepth(int depth, F &&f) {
+    switch (depth) {
+    case CV_8U:  f(uchar()); return true;
+    case CV_32F: f(float()); return true;
+    case CV_64F: f(double()); return true;
+    }
+    return false;
+}
+
+static const char *NOISE_TYPE_NAMES[] = { "salt_pepper", "random_value", "gaussian", "poisson", "mixed" };
 
-    applyNoise(image, noiseRatio, noiseType,
-               static_cast<std::function<cv::Vec3f()>>(saltAndPepperFunc),
-               static_cast<std::function<cv::Vec3f()>>(randomValueFunc));
+static uint64_t thresholdFor(double density) {
+    return static_cast<uint64_t>(std::min(1.0, std::max(0.0, density)) * 4294967296.0);
 }
 
 
 
 
 ImpulseNoise::ImpulseNoise()
+    : noiseSeed((static_cast<quint64>(std::random_device{}()) << 32) | std::random_device{}()),
+    noiseType(NoiseType::SALT_AND_PEPPER), monotone(false)
 {
 }
 ImpulseNoise::~ImpulseNoise()
 {
 }
 
+quint64 ImpulseNoise::seed() const
+{
+    return noiseSeed;
+}
+
+void ImpulseNoise::setSeed(quint64 seed)
+{
+    noiseSeed = seed;
+}
+
+QString ImpulseNoise::noiseTypeName() const
+{
+    return NOISE_TYPE_NAMES[static_cast<int>(noiseType)];
+}
+
+void ImpulseNoise::setNoiseTypeName(const QString &name)
+{
+    for (int i = 0; i < 5; ++i) {
+        if (name.compare(NOISE_TYPE_NAMES[i], Qt::CaseInsensitive) == 0) {
+            noiseType = static_cast<NoiseType>(i);
+            resetNoiseCache();
+            return;
+        }
+    }
+    qDebug() << "ImpulseNoise: unknown noise type" << name;
+}
+
+void ImpulseNoise::setMonotone(bool enabled)
+{
+    monotone = enabled;
+    if (!enabled) {
+        resetNoiseCache();
+    }
+}
+
+void ImpulseNoise::resetNoiseCache()
+{
+    mask = NoiseMask();
+}
+
+void ImpulseNoise::buildMask(const cv::Mat &inputImage)
+{
+    const int rows = inputImage.rows;
+    const int cols = inputImage.cols;
+    const size_t total = static_cast<size_t>(rows) * cols;
+    Philox4x32 rng(noiseSeed);
+
+    // Counting sort of the pixels by the top 16 bits of their hit word
+    std::vector<uint16_t> bucketOf(total);
+#pragma omp parallel for schedule(static)
+    for (int i = 0; i < rows; ++i) {
+        uint16_t *bucket = bucketOf.data() + static_cast<size_t>(i) * cols;
+        for (int j = 0; j < cols; ++j) {
+            bucket[j] = static_cast<uint16_t>(rng(static_cast<uint32_t>(i), static_cast<uint32_t>(j), STREAM_HIT).v[0] >> 16);
+        }
+    }
+
+    mask.bucketStart.assign(65537, 0);
+    for (size_t k = 0; k < total; ++k) {
+        ++mask.bucketStart[bucketOf[k] + 1];
+    }
+    for (int b = 0; b < 65536; ++b) {
+        mask.bucketStart[b + 1] += mask.bucketStart[b];
+    }
+
+    std::vector<uint32_t> next(mask.bucketStart.begin(), mask.bucketStart.end() - 1);
+    mask.order.resize(total);
+    for (size_t k = 0; k < total; ++k) {
+        mask.order[next[bucketOf[k]]++] = static_cast<uint32_t>(k);
+    }
+
+    mask.input = inputImage.data;
+    mask.output = nullptr;
+    mask.size = inputImage.size();
+    mask.type = inputImage.type();
+    mask.seed = noiseSeed;
+    mask.appliedThreshold = 0;
+}
+
+void ImpulseNoise::processMonotone(const cv::Mat &inputImage, cv::Mat &outputImage, const float noise_density, NoiseType noiseType)
+{
+    bool sameInput = mask.input == inputImage.data && mask.size == inputImage.size()
+                     && mask.type == inputImage.type() && mask.seed == noiseSeed;
+    if (!sameInput) {
+        buildMask(inputImage);
+    }
+
+    // In place only when the host handed back the buffer we wrote last time
+    bool inPlace = mask.output != nullptr && outputImage.data == mask.output
+                   && outputImage.size() == inputImage.size() && outputImage.type() == inputImage.type();
+    if (!inPlace) {
+        inputImage.copyTo(outputImage);
+        mask.output = outputImage.data;
+        mask.appliedThreshold = 0;
+    }
+
+    const uint64_t threshold = thresholdFor(noise_density);
+    Philox4x32 rng(noiseSeed);
+    QRect changed;
+    dispatchPixelType(inputImage.type(), [&](auto pixel) {
+        using T = decltype(pixel);
+        changed = updateMaskRange<T>(inputImage, outputImage, mask.order, mask.bucketStart,
+                                     mask.appliedThreshold, threshold, noiseType, rng);
+    });
+    mask.appliedThreshold = threshold;
+
+    dirty = inPlace ? changed : QRect(0, 0, inputImage.cols, inputImage.rows);
+}
+
 QString ImpulseNoise::context_menu_str()
 {
     return "Add Noise";
@@ -158,23 +454,49 @@ QString ImpulseNoise::context_menu_str()
 
 void ImpulseNoise::processImage(const cv::Mat &inputImage, cv::Mat &outputImage, const float noise_density)
 {
+    // The threshold mask only describes impulse noise; additive models always take the full pass
+    bool impulse = noiseType == NoiseType::SALT_AND_PEPPER || noiseType == NoiseType::RANDOM_VALUE;
+    if (monotone && impulse) {
+        processMonotone(inputImage, outputImage, noise_density, noiseType);
+        return;
+    }
+
     inputImage.copyTo(outputImage);
+    dirty = QRect(0, 0, inputImage.cols, inputImage.rows);
+    applyNoise(outputImage, noise_density, noiseType);
+}
 
-    NoiseType noiseType = NoiseType::SALT_AND_PEPPER;
+void ImpulseNoise::applyNoise(cv::Mat &image, const float noise_density, NoiseType type)
+{
+    Philox4x32 rng(noiseSeed);
 
-    // Process the image based on its type
-    if (inputImage.type() == CV_8UC1) {
-        addImpulseNoise<uchar>(outputImage, noise_density, noiseType);
-    } else if (inputImage.type() == CV_32FC1) {
-        addImpulseNoise<float>(outputImage, noise_density, noiseType);
-    } else if (inputImage.type() == CV_64FC1) {
-        addImpulseNoise<double>(outputImage, noise_density, noiseType);
-    } else if (inputImage.type() == CV_8UC3) {
-        addImpulseNoise<cv::Vec3b>(outputImage, noise_density, noiseType);
-    } else if (inputImage.type() == CV_32FC3) {
-        addImpulseNoise<cv::Vec3f>(outputImage, noise_density, noiseType);
-    } else if (inputImage.type() == CV_64FC3) {
-        addImpulseNoise<cv::Vec3d>(outputImage, noise_density, noiseType);
+    // One Philox block carries the four words a pixel needs at most
+    if (image.channels() > 4) {
+        qDebug() << "ImpulseNoise: images with more than 4 channels are not supported.";
+        return;
+    }
+
+    switch (type) {
+    case NoiseType::SALT_AND_PEPPER:
+    case NoiseType::RANDOM_VALUE:
+        dispatchPixelType(image.type(), [&](auto pixel) {
+            addImpulseNoise<decltype(pixel)>(image, noise_density, type, rng);
+        });
+        break;
+    case NoiseType::GAUSSIAN:
+        dispatchDepth(image.depth(), [&](auto value) {
+            addGaussianNoise<decltype(value)>(image, noise_density, rng);
+        });
+        break;
+    case NoiseType::POISSON:
+        dispatchDepth(image.depth(), [&](auto value) {
+            addPoissonNoise<decltype(value)>(image, noise_density, rng);
+        });
+        break;
+    case NoiseType::MIXED:
+        applyNoise(image, noise_density, NoiseType::GAUSSIAN);
+        applyNoise(image, noise_density, NoiseType::SALT_AND_PEPPER);
+        break;
     }
 }
 
@@ -186,24 +508,18 @@ void ImpulseNoise::addSaltAndPepperNoise(cv::Mat &image, const float noise_denis
         throw std::invalid_argument("saltPepperRatio should be between 0 and 1.");
     }
 
-    // Number of pixels to alter
-    int totalPixels = image.rows * image.cols;
-    int numSaltPepperPixels = static_cast<int>(totalPixels * noise_denisity);
-
-    // Loop through and apply noise
-    for (int i = 0; i < numSaltPepperPixels; ++i) {
-        int x = std::rand() % image.cols;
-        int y = std::rand() % image.rows;
-
-        // Decide between salt and pepper
-        if (std::rand() % 2 == 0) {
-            // Salt (white)
-            image.at<cv::Vec3b>(y, x) = cv::Vec3b(255, 255, 255);
-        } else {
-            // Pepper (black)
-            image.at<cv::Vec3b>(y, x) = cv::Vec3b(0, 0, 0);
+    // Same seeded per-pixel generator as processImage, with full-pixel salt or pepper
+    Philox4x32 rng(noiseSeed);
+    const uint64_t threshold = static_cast<uint64_t>(static_cast<double>(noise_denisity) * 4294967296.0);
+
+#pragma omp parallel for schedule(static)
+    for (int y = 0; y < image.rows; ++y) {
+        cv::Vec3b *row = image.ptr<cv::Vec3b>(y);
+        for (int x = 0; x < image.cols; ++x) {
+            Philox4x32::Block block = rng(static_cast<uint32_t>(y), static_cast<uint32_t>(x), STREAM_HIT);
+            if (block.v[0] < threshold) {
+                row[x] = (block.v[1] & 1u) ? cv::Vec3b(255, 255, 255) : cv::Vec3b(0, 0, 0);
+            }
         }
     }
 }
-
-
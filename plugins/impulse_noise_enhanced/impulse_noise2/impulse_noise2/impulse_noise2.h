@@ -3,13 +3,19 @@
 
 #include "impulse_noise2_global.h"
 #include "plugin_interface_noise.h"
+#include "philox.h"
 #include <QObject>
+#include <QRect>
 #include <QString>
 #include <opencv2/core.hpp>
+#include <vector>
 
 enum class NoiseType {
     SALT_AND_PEPPER,
-    RANDOM_VALUE
+    RANDOM_VALUE,   // Uniform value, drawn per channel
+    GAUSSIAN,       // Additive, sigma = density * full scale
+    POISSON,        // Shot noise, relative noise at full scale = density
+    MIXED           // Gaussian followed by salt and pepper, both at the same density
 };
 
 // Ensure the class uses the export/import macro
@@ -18,15 +24,59 @@ class IMPULSE_NOISE2_EXPORT ImpulseNoise : public QObject, public PluginInterfac
     Q_OBJECT
     Q_PLUGIN_METADATA(IID PLUGININTERFACE_IID)
     Q_INTERFACES(PluginInterfaceNoise)
+    // Set by the host through QObject::setProperty, so the interface stays unchanged
+    Q_PROPERTY(quint64 seed READ seed WRITE setSeed)
+    Q_PROPERTY(bool monotone READ isMonotone WRITE setMonotone)
+    Q_PROPERTY(QRect dirtyRect READ dirtyRect)
+    Q_PROPERTY(QString noiseType READ noiseTypeName WRITE setNoiseTypeName)
 
 public:
     ImpulseNoise();
     ~ImpulseNoise();
+    quint64 seed() const;
+    void setSeed(quint64 seed);
+
+    // salt_pepper (default), random_value, gaussian, poisson or mixed. For the additive
+    // models noise_density is the noise level relative to full scale rather than a ratio.
+    QString noiseTypeName() const;
+    void setNoiseTypeName(const QString &name);
+
+    // Monotone mode: a pixel is corrupted at density p iff its fixed threshold u(row, col) < p,
+    // so raising or lowering p only touches the pixels whose threshold lies in between.
+    // When processImage gets the same input and the output buffer of the previous call,
+    // it updates that buffer in place and reports the changed area through dirtyRect.
+    bool isMonotone() const { return monotone; }
+    void setMonotone(bool enabled);
+    QRect dirtyRect() const { return dirty; }
+    Q_INVOKABLE void resetNoiseCache(); // Call when the input buffer is reused for another image
+
     QString context_menu_str() override;
     void processImage(const cv::Mat &inputImage, cv::Mat &outputImage, const float noise_density) override;
 
 private:
     void addSaltAndPepperNoise(cv::Mat &image, const float noise_density);
+    void applyNoise(cv::Mat &image, const float noise_density, NoiseType noiseType);
+
+    void processMonotone(const cv::Mat &inputImage, cv::Mat &outputImage, const float noise_density, NoiseType noiseType);
+    void buildMask(const cv::Mat &inputImage);
+
+    quint64 noiseSeed; // Random per instance unless the host sets one
+    NoiseType noiseType;
+    bool monotone;
+    QRect dirty;
+
+    // Pixel indices bucketed by the top 16 bits of their threshold word, so the pixels
+    // between two densities are a contiguous run of buckets
+    struct NoiseMask {
+        const uchar *input = nullptr;
+        const uchar *output = nullptr;
+        cv::Size size;
+        int type = -1;
+        quint64 seed = 0;
+        std::vector<uint32_t> order;
+        std::vector<uint32_t> bucketStart;
+        uint64_t appliedThreshold = 0;
+    } mask;
 };
 
 #endif // IMPULSE_NOISE2_H
@@ -37,6 +37,7 @@ HEADERS += \
     impulse_noise2_global.h \
     impulse_noise2.h \
     impulse_noise2_plugin.h \
+    philox.h \
     plugin_interface_noise.h
 
 # Define preprocessor macro for the plugin build
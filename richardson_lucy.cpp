@@ -0,0 +1,190 @@
+#include "richardson_lucy.h"
+#include <opencv2/core/utility.hpp>
+#include <opencv2/imgproc.hpp>
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+#include <utility>
+
+static const float RATIO_LIMIT = 5.0f; // Caps the correction where the blurred estimate is near zero
+static const float EPSILON = 1e-6f;
+
+RichardsonLucy::RichardsonLucy()
+    : maxIterations(50), tolerance(0.0), accelerated(false)
+{
+    setPsf(9, 2.0);
+}
+
+void RichardsonLucy::setPsf(int size, double sigma)
+{
+    size = std::max(1, size | 1);
+    kernel = cv::getGaussianKernel(size, sigma, CV_32F);
+}
+
+void RichardsonLucy::setMaxIterations(int iterations)
+{
+    maxIterations = std::max(1, iterations);
+}
+
+void RichardsonLucy::setTolerance(double value)
+{
+    tolerance = std::max(0.0, value);
+}
+
+void RichardsonLucy::setAcceleration(bool enabled)
+{
+    accelerated = enabled;
+}
+
+// Sums over one iteration, gathered per row range and added up under a lock
+struct IterationSums {
+    double stepDot = 0.0;      // step . previous step
+    double previousNorm = 0.0; // previous step . previous step
+    double change = 0.0;       // |new estimate - old estimate|
+    double total = 0.0;        // |old estimate|
+};
+
+// y = clamp(x + alpha (x - previous x), 0, 1)
+static void predict(const cv::Mat &estimate, const cv::Mat &previous, float alpha, cv::Mat &predicted)
+{
+    cv::parallel_for_(cv::Range(0, estimate.rows), [&](const cv::Range &range) {
+        for (int y = range.start; y < range.end; ++y) {
+            const float *x = estimate.ptr<float>(y);
+            const float *p = previous.ptr<float>(y);
+            float *out = predicted.ptr<float>(y);
+            for (int i = 0; i < estimate.cols; ++i) {
+                out[i] = std::min(1.0f, std::max(0.0f, x[i] + alpha * (x[i] - p[i])));
+            }
+        }
+    });
+}
+
+// ratio = min(observed / (blurred + eps), limit)
+static void divide(const cv::Mat &observed, const cv::Mat &blurred, cv::Mat &ratio)
+{
+    cv::parallel_for_(cv::Range(0, observed.rows), [&](const cv::Range &range) {
+        for (int y = range.start; y < range.end; ++y) {
+            const float *o = observed.ptr<float>(y);
+            const float *b = blurred.ptr<float>(y);
+            float *out = ratio.ptr<float>(y);
+            for (int i = 0; i < observed.cols; ++i) {
+                out[i] = std::min(RATIO_LIMIT, o[i] / (b[i] + EPSILON));
+            }
+        }
+    });
+}
+
+// next = clamp(start * correction, 0, 1), written over the estimate before last. The
+// new step overwrites the step before last while its dot with the last step is taken.
+static IterationSums update(const cv::Mat &start, const cv::Mat &correction, const cv::Mat &estimate,
+                            cv::Mat &next, const cv::Mat &step, cv::Mat &newStep, bool trackSteps)
+{
+    IterationSums sums;
+    std::mutex mutex;
+    cv::parallel_for_(cv::Range(0, start.rows), [&](const cv::Range &range) {
+        IterationSums local;
+        for (int y = range.start; y < range.end; ++y) {
+            const float *s = start.ptr<float>(y);
+            const float *c = correction.ptr<float>(y);
+            const float *x = estimate.ptr<float>(y);
+            float *out = next.ptr<float>(y);
+            for (int i = 0; i < start.cols; ++i) {
+                float value = std::min(1.0f, std::max(0.0f, s[i] * c[i]));
+                local.change += std::fabs(value - x[i]);
+                local.total += std::fabs(x[i]);
+                out[i] = value;
+            }
+            if (trackSteps) {
+                const float *g = step.ptr<float>(y);
+                float *gNew = newStep.ptr<float>(y);
+                for (int i = 0; i < start.cols; ++i) {
+                    float v = out[i] - s[i];
+                    local.stepDot += static_cast<double>(v) * g[i];
+                    local.previousNorm += static_cast<double>(g[i]) * g[i];
+                    gNew[i] = v;
+                }
+            }
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        sums.stepDot += local.stepDot;
+        sums.previousNorm += local.previousNorm;
+        sums.change += local.change;
+        sums.total += local.total;
+    });
+    return sums;
+}
+
+void RichardsonLucy::run(Channel &channel) const
+{
+    const cv::Mat &observed = channel.observed;
+    const int rows = observed.rows, cols = observed.cols;
+    channel.previous.create(rows, cols, CV_32F);
+    channel.predicted.create(rows, cols, CV_32F);
+    channel.blurred.create(rows, cols, CV_32F);
+    channel.ratio.create(rows, cols, CV_32F);
+    if (accelerated) {
+        channel.step.create(rows, cols, CV_32F);
+        channel.previousStep.create(rows, cols, CV_32F);
+        channel.step.setTo(0.0f);
+    }
+    observed.copyTo(channel.estimate);
+
+    float alpha = 0.0f;
+    channel.iterations = 0;
+    for (int k = 0; k < maxIterations; ++k) {
+        const cv::Mat *start = &channel.estimate;
+        if (alpha > 0.0f) {
+            predict(channel.estimate, channel.previous, alpha, channel.predicted);
+            start = &channel.predicted;
+        }
+
+        cv::sepFilter2D(*start, channel.blurred, CV_32F, kernel, kernel);
+        divide(observed, channel.blurred, channel.ratio);
+        cv::sepFilter2D(channel.ratio, channel.blurred, CV_32F, kernel, kernel, cv::Point(-1, -1), 0, cv::BORDER_REPLICATE);
+
+        IterationSums sums = update(*start, channel.blurred, channel.estimate, channel.previous,
+                                    channel.step, channel.previousStep, accelerated);
+        std::swap(channel.estimate, channel.previous);
+        channel.iterations = k + 1;
+
+        if (accelerated) {
+            std::swap(channel.step, channel.previousStep);
+            // The first step has no predecessor to compare with
+            alpha = k > 0 && sums.previousNorm > 0.0
+                        ? static_cast<float>(std::min(1.0, std::max(0.0, sums.stepDot / sums.previousNorm)))
+                        : 0.0f;
+        }
+        if (tolerance > 0.0 && sums.change <= tolerance * std::max(sums.total, 1e-12)) {
+            break;
+        }
+    }
+}
+
+int RichardsonLucy::deconvolve(const cv::Mat &observed, cv::Mat &restored)
+{
+    if (observed.empty() || observed.depth() != CV_32F) {
+        return 0;
+    }
+
+    // Channels one after another: the passes inside run() are row-parallel, and OpenCV
+    // would run them serially if nested in a per-channel parallel region
+    const int count = observed.channels();
+    channels.resize(count);
+    for (int c = 0; c < count; ++c) {
+        cv::extractChannel(observed, channels[c].observed, c);
+        run(channels[c]);
+    }
+
+    int iterations = 0;
+    std::vector<cv::Mat> planes(count);
+    for (int c = 0; c < count; ++c) {
+        planes[c] = channels[c].estimate;
+        iterations = std::max(iterations, channels[c].iterations);
+    }
+    if (count == 1) {
+        planes[0].copyTo(restored); // The planes are reused by the next call
+    } else {
+        cv::merge(planes, restored);
+    }
+    return iterations;
+}
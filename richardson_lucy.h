@@ -0,0 +1,55 @@
+#ifndef RICHARDSON_LUCY_H
+#define RICHARDSON_LUCY_H
+
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+// Richardson-Lucy deconvolution with a Gaussian PSF. The PSF is separable, so both
+// blurs of an iteration are a row and a column pass of its 1-D kernel, which is built
+// once per PSF. Every per-pixel step between the blurs (ratio, clip, update, clamp and
+// the sums for acceleration and convergence) is one fused row-parallel pass. Planes are
+// kept between calls and only reallocated when the image size changes.
+//
+// By default it runs a fixed 50 plain iterations, the same arithmetic as the loop
+// applyDeBlur used before. Two options are off until tools/deblur_compare shows what
+// they cost in quality: acceleration, where each iteration starts from the estimate
+// extrapolated along the last step (Biggs and Andrews 1997), and a tolerance, which
+// stops a channel once an iteration changes its estimate by less than that fraction.
+class RichardsonLucy
+{
+public:
+    RichardsonLucy();
+
+    void setPsf(int size, double sigma);     // Odd size
+    void setMaxIterations(int iterations);
+    void setTolerance(double tolerance);     // Relative L1 change; 0 always runs every iteration
+    void setAcceleration(bool enabled);
+
+    int psfRadius() const { return kernel.rows / 2; }
+
+    // Float image in [0, 1], any channel count; returns the iterations run by the
+    // slowest channel
+    int deconvolve(const cv::Mat &observed, cv::Mat &restored);
+
+private:
+    struct Channel {
+        cv::Mat observed;
+        cv::Mat estimate, previous; // Swapped after every iteration
+        cv::Mat step, previousStep; // estimate - predicted, for the acceleration
+        cv::Mat predicted;
+        cv::Mat blurred;            // Blurred prediction, then the correction factors
+        cv::Mat ratio;
+        int iterations = 0;
+    };
+
+    void run(Channel &channel) const;
+
+    cv::Mat kernel; // 1-D, column
+    int maxIterations;
+    double tolerance;
+    bool accelerated;
+    std::vector<Channel> channels;
+};
+
+#endif // RICHARDSON_LUCY_H
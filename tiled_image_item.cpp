@@ -0,0 +1,244 @@
+#include "tiled_image_item.h"
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
+#include <QThreadPool>
+#include <algorithm>
+#include <cmath>
+
+#include <opencv2/imgproc.hpp>
+
+static const qint64 MIN_BUDGET = 16ll << 20; // Always room for the tiles of one screen
+
+TiledImageItem::TiledImageItem(QGraphicsItem *parent)
+    : QGraphicsObject(parent), link(std::make_shared<OwnerLink<TiledImageItem>>(this)),
+    generation(std::make_shared<std::atomic<quint64>>(0))
+{
+    levels.append(QImage());
+    tiles.setMaxCost(256 * 1024); // 256 MiB
+    setFlag(QGraphicsItem::ItemUsesExtendedStyleOption); // exposedRect is then the dirty area
+}
+
+TiledImageItem::~TiledImageItem()
+{
+    link->detach();
+    ++*generation;
+}
+
+void TiledImageItem::setMemoryBudget(qint64 bytes)
+{
+    tiles.setMaxCost(static_cast<int>(std::max(bytes, MIN_BUDGET) / 1024));
+}
+
+QRectF TiledImageItem::boundingRect() const
+{
+    return QRectF(levels.first().rect());
+}
+
+quint64 TiledImageItem::tileKey(int level, int tx, int ty)
+{
+    return (static_cast<quint64>(level) << 48) | (static_cast<quint64>(ty) << 24) | static_cast<quint64>(tx);
+}
+
+// INTER_AREA through a cv::Mat view for the byte formats we display; Qt's smooth scaling otherwise
+QImage TiledImageItem::resized(const QImage &image, const QSize &size)
+{
+    int type = -1;
+    switch (image.format()) {
+    case QImage::Format_Grayscale8: type = CV_8UC1; break;
+    case QImage::Format_RGB888:
+    case QImage::Format_BGR888:     type = CV_8UC3; break;
+    case QImage::Format_RGB32:
+    case QImage::Format_ARGB32:
+    case QImage::Format_ARGB32_Premultiplied: type = CV_8UC4; break;
+    default: break;
+    }
+    if (type < 0) {
+        return image.scaled(size, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+    }
+
+    QImage result(size, image.format());
+    cv::Mat src(image.height(), image.width(), type, const_cast<uchar *>(image.constBits()), image.bytesPerLine());
+    cv::Mat dst(result.height(), result.width(), type, result.bits(), result.bytesPerLine());
+    cv::resize(src, dst, dst.size(), 0, 0, cv::INTER_AREA);
+    return result;
+}
+
+void TiledImageItem::setImage(const QImage &image)
+{
+    prepareGeometryChange();
+    levels.clear();
+    levels.append(image);
+    tiles.clear();
+    buildPyramid();
+    update();
+}
+
+void TiledImageItem::buildPyramid()
+{
+    const quint64 job = ++*generation;
+    const QImage base = levels.first();
+    if (std::max(base.width(), base.height()) <= TILE_SIZE) {
+        return; // One tile already
+    }
+
+    std::shared_ptr<OwnerLink<TiledImageItem>> shared = link;
+    std::shared_ptr<std::atomic<quint64>> latest = generation;
+    QThreadPool::globalInstance()->start([shared, latest, base, job]() {
+        QVector<QImage> pyramid;
+        QImage current = base;
+        while (std::max(current.width(), current.height()) > TILE_SIZE) {
+            if (*latest != job) {
+                return; // Superseded by a newer image
+            }
+            current = resized(current, QSize((current.width() + 1) / 2, (current.height() + 1) / 2));
+            pyramid.append(current);
+        }
+
+        shared->post([job, pyramid](TiledImageItem *owner) {
+            owner->pyramidReady(job, pyramid);
+        });
+    });
+}
+
+void TiledImageItem::pyramidReady(quint64 job, const QVector<QImage> &pyramid)
+{
+    if (job != *generation) {
+        return;
+    }
+    levels.resize(1);
+    levels += pyramid;
+    update();
+}
+
+void TiledImageItem::updateRegion(const QImage &image, const QRect &dirty)
+{
+    QRect region = dirty.intersected(levels.first().rect());
+    if (region.isEmpty()) {
+        return;
+    }
+
+    {
+        QPainter painter(&levels.first());
+        painter.setCompositionMode(QPainter::CompositionMode_Source);
+        painter.drawImage(region.topLeft(), image, region);
+    }
+    invalidateTiles(0, region);
+
+    bool pyramidPending = levels.size() == 1 && std::max(levels.first().width(), levels.first().height()) > TILE_SIZE;
+    if (pyramidPending) {
+        buildPyramid(); // The running job started from the old pixels
+    } else {
+        // Each level only recomputes the pixels over the changed area
+        QRect levelRect = region;
+        for (int level = 1; level < levels.size(); ++level) {
+            levelRect = refreshLevel(level, levelRect);
+            invalidateTiles(level, levelRect);
+        }
+    }
+    update(QRectF(region));
+}
+
+QRect TiledImageItem::refreshLevel(int level, const QRect &previousRect)
+{
+    QImage &target = levels[level];
+    const QImage &finer = levels[level - 1];
+
+    QRect rect = QRect(QPoint(previousRect.left() / 2, previousRect.top() / 2),
+                       QPoint(previousRect.right() / 2, previousRect.bottom() / 2)).intersected(target.rect());
+    QRect source = QRect(rect.x() * 2, rect.y() * 2, rect.width() * 2, rect.height() * 2).intersected(finer.rect());
+    if (rect.isEmpty() || source.isEmpty()) {
+        return rect;
+    }
+
+    QImage piece = resized(finer.copy(source), rect.size());
+    QPainter painter(&target);
+    painter.setCompositionMode(QPainter::CompositionMode_Source);
+    painter.drawImage(rect.topLeft(), piece);
+    return rect;
+}
+
+void TiledImageItem::invalidateTiles(int level, const QRect &levelRect)
+{
+    if (levelRect.isEmpty()) {
+        return;
+    }
+    for (int ty = levelRect.top() / TILE_SIZE; ty <= levelRect.bottom() / TILE_SIZE; ++ty) {
+        for (int tx = levelRect.left() / TILE_SIZE; tx <= levelRect.right() / TILE_SIZE; ++tx) {
+            tiles.remove(tileKey(level, tx, ty));
+        }
+    }
+}
+
+int TiledImageItem::levelFor(qreal levelOfDetail) const
+{
+    if (levelOfDetail >= 1.0 || levelOfDetail <= 0.0) {
+        return 0;
+    }
+    // Finest level that is still at least as dense as the screen
+    return static_cast<int>(std::floor(std::log2(1.0 / levelOfDetail)));
+}
+
+QPixmap *TiledImageItem::tile(int level, int tx, int ty)
+{
+    quint64 key = tileKey(level, tx, ty);
+    if (QPixmap *pixmap = tiles.object(key)) {
+        return pixmap;
+    }
+
+    const QImage &image = levels[level];
+    QRect rect = QRect(tx * TILE_SIZE, ty * TILE_SIZE, TILE_SIZE, TILE_SIZE).intersected(image.rect());
+    QPixmap *pixmap = new QPixmap(QPixmap::fromImage(image.copy(rect)));
+    int cost = std::max(1, rect.width() * rect.height() * 4 / 1024);
+    if (!tiles.insert(key, pixmap, cost)) {
+        return nullptr; // Larger than the whole budget; QCache has deleted it
+    }
+    return pixmap;
+}
+
+void TiledImageItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget)
+{
+    Q_UNUSED(widget);
+    const QImage &base = levels.first();
+    if (base.isNull()) {
+        return;
+    }
+
+    QRectF exposed = option->exposedRect.intersected(boundingRect());
+    if (exposed.isEmpty()) {
+        return;
+    }
+
+    const qreal lod = QStyleOptionGraphicsItem::levelOfDetailFromTransform(painter->worldTransform());
+    const int wanted = levelFor(lod);
+
+    // Zoomed out before the pyramid is ready: scale straight from the image, without caching
+    if (wanted > 0 && levels.size() == 1) {
+        painter->setRenderHint(QPainter::SmoothPixmapTransform, true);
+        painter->drawImage(exposed, base, exposed);
+        return;
+    }
+
+    const int level = std::min(wanted, static_cast<int>(levels.size()) - 1);
+    const QImage &image = levels[level];
+    const qreal sx = static_cast<qreal>(base.width()) / image.width();
+    const qreal sy = static_cast<qreal>(base.height()) / image.height();
+
+    // Magnified pixels stay sharp for inspection; minified tiles are filtered
+    painter->setRenderHint(QPainter::SmoothPixmapTransform, lod * sx < 1.0);
+
+    int tx0 = std::max(0, static_cast<int>(exposed.left() / sx) / TILE_SIZE);
+    int ty0 = std::max(0, static_cast<int>(exposed.top() / sy) / TILE_SIZE);
+    int tx1 = std::min((image.width() - 1) / TILE_SIZE, static_cast<int>(exposed.right() / sx) / TILE_SIZE);
+    int ty1 = std::min((image.height() - 1) / TILE_SIZE, static_cast<int>(exposed.bottom() / sy) / TILE_SIZE);
+
+    for (int ty = ty0; ty <= ty1; ++ty) {
+        for (int tx = tx0; tx <= tx1; ++tx) {
+            QPixmap *pixmap = tile(level, tx, ty);
+            if (!pixmap) {
+                continue;
+            }
+            QRectF target(tx * TILE_SIZE * sx, ty * TILE_SIZE * sy, pixmap->width() * sx, pixmap->height() * sy);
+            painter->drawPixmap(target, *pixmap, QRectF(pixmap->rect()));
+        }
+    }
+}
@@ -0,0 +1,60 @@
+#ifndef TILED_IMAGE_ITEM_H
+#define TILED_IMAGE_ITEM_H
+
+#include <QCache>
+#include <QGraphicsObject>
+#include <QImage>
+#include <QPixmap>
+#include <QVector>
+
+#include <atomic>
+#include <memory>
+
+#include "owner_link.h"
+
+// Scene item for images of any size. The image is split into tiles and a mip
+// pyramid of half-size levels is built on the thread pool. paint() draws only the
+// tiles inside the exposed rectangle, from the level that matches the current
+// zoom, so neither a pan nor a zoom ever touches the whole image. Tiles become
+// pixmaps on first use and live in an LRU bounded by a memory budget.
+class TiledImageItem : public QGraphicsObject
+{
+    Q_OBJECT
+
+public:
+    static const int TILE_SIZE = 512;
+
+    explicit TiledImageItem(QGraphicsItem *parent = nullptr);
+    ~TiledImageItem();
+
+    void setImage(const QImage &image);                          // Shallow copy; levels follow in the background
+    void updateRegion(const QImage &image, const QRect &dirty);  // Same size; refreshes every level over dirty
+    const QImage &image() const { return levels.first(); }
+    int readyLevels() const { return levels.size(); }
+
+    void setMemoryBudget(qint64 bytes);
+
+    QRectF boundingRect() const override;
+    void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget = nullptr) override;
+
+private:
+    void buildPyramid();
+    void pyramidReady(quint64 job, const QVector<QImage> &pyramid);
+    QRect refreshLevel(int level, const QRect &previousRect);
+    void invalidateTiles(int level, const QRect &levelRect);
+    int levelFor(qreal levelOfDetail) const;
+    QPixmap *tile(int level, int tx, int ty);
+
+    static quint64 tileKey(int level, int tx, int ty);
+    static QImage resized(const QImage &image, const QSize &size);
+
+    // Shared with the pyramid job. The generation is bumped whenever a running job
+    // becomes stale, so the job can stop early and its result is dropped.
+    std::shared_ptr<OwnerLink<TiledImageItem>> link;
+    std::shared_ptr<std::atomic<quint64>> generation;
+
+    QVector<QImage> levels;         // levels[0] is the image itself; the rest once the job is done
+    QCache<quint64, QPixmap> tiles; // Cost in KiB
+};
+
+#endif // TILED_IMAGE_ITEM_H
@@ -0,0 +1,25 @@
+# Console comparison of the Richardson-Lucy engine against the previous fixed loop
+TEMPLATE = app
+CONFIG += console c++17
+CONFIG -= app_bundle qt
+
+win32: {
+    INCLUDEPATH += C:/opencv/opencv/build/include
+    LIBS += -LC:/opencv/opencv/build/x64/vc16/lib \
+            -lopencv_world490
+}
+
+linux: {
+    INCLUDEPATH += /usr/include/opencv4
+    LIBS += -L/usr/lib/x86_64-linux-gnu \
+            -lopencv_core -lopencv_imgproc -lopencv_imgcodecs
+}
+
+INCLUDEPATH += ../..
+
+SOURCES += \
+    deblur_compare.cpp \
+    ../../richardson_lucy.cpp
+
+HEADERS += \
+    ../../richardson_lucy.h
@@ -0,0 +1,194 @@
+#include "video_encoder.h"
+#include <QDebug>
+#include <QStringList>
+#include <QtGlobal>
+#include <algorithm>
+#include <chrono>
+
+VideoEncoder::VideoEncoder(int queueCapacity)
+    : capacity(std::max(1, queueCapacity)), stopping(false),
+    running(false), fpsEstimate(0.0), encodedCount(0)
+{
+}
+
+VideoEncoder::~VideoEncoder()
+{
+    close();
+}
+
+QStringList VideoEncoder::formatNames()
+{
+    return { formatName(VideoCodec::MJPG), formatName(VideoCodec::FFV1),
+            formatName(VideoCodec::H264), formatName(VideoCodec::RAW) };
+}
+
+QString VideoEncoder::formatName(VideoCodec codec)
+{
+    switch (codec) {
+    case VideoCodec::MJPG: return "AVI (MJPG)";
+    case VideoCodec::FFV1: return "MKV (FFV1 lossless)";
+    case VideoCodec::H264: return "MP4 (H.264)";
+    case VideoCodec::RAW:  return "AVI (Raw)";
+    }
+    return "AVI (MJPG)";
+}
+
+VideoCodec VideoEncoder::codecFromFormat(const QString &format)
+{
+    if (format.contains("FFV1", Qt::CaseInsensitive)) return VideoCodec::FFV1;
+    if (format.contains("264", Qt::CaseInsensitive)) return VideoCodec::H264;
+    if (format.contains("Raw", Qt::CaseInsensitive)) return VideoCodec::RAW;
+    if (format.compare("MKV", Qt::CaseInsensitive) == 0) return VideoCodec::FFV1;
+    return VideoCodec::MJPG;
+}
+
+QString VideoEncoder::containerExtension(VideoCodec codec)
+{
+    switch (codec) {
+    case VideoCodec::FFV1: return "mkv";
+    case VideoCodec::H264: return "mp4";
+    case VideoCodec::MJPG:
+    case VideoCodec::RAW:  return "avi";
+    }
+    return "avi";
+}
+
+bool VideoEncoder::open(const QString &path, VideoCodec codec, double fps, const cv::Size &frameSize, int threads)
+{
+    close();
+
+    if (fps <= 0.0) {
+        fps = 30.0;
+    }
+
+    int fourcc = 0;
+    int backend = cv::CAP_FFMPEG;
+    switch (codec) {
+    case VideoCodec::MJPG:
+        fourcc = cv::VideoWriter::fourcc('M', 'J', 'P', 'G');
+        backend = cv::CAP_ANY;
+        break;
+    case VideoCodec::FFV1:
+        fourcc = cv::VideoWriter::fourcc('F', 'F', 'V', '1');
+        break;
+    case VideoCodec::H264:
+        fourcc = cv::VideoWriter::fourcc('a', 'v', 'c', '1');
+        break;
+    case VideoCodec::RAW:
+        fourcc = 0; // The FFmpeg backend maps fourcc 0 to rawvideo
+        break;
+    }
+
+    // The FFmpeg backend reads its codec options from the environment when the writer opens
+    if (threads > 0) {
+        qputenv("OPENCV_FFMPEG_WRITER_OPTIONS", QByteArray("threads;") + QByteArray::number(threads));
+    } else {
+        qunsetenv("OPENCV_FFMPEG_WRITER_OPTIONS");
+    }
+
+    writer.open(path.toStdString(), backend, fourcc, fps, frameSize, true);
+    if (!writer.isOpened() && codec == VideoCodec::H264) {
+        // Some FFmpeg builds only register the encoder under the H264 tag
+        writer.open(path.toStdString(), backend, cv::VideoWriter::fourcc('H', '2', '6', '4'), fps, frameSize, true);
+    }
+    if (!writer.isOpened()) {
+        qDebug() << "VideoEncoder: could not open" << path << "as" << formatName(codec);
+        return false;
+    }
+
+    if (codec == VideoCodec::MJPG && threads > 0) {
+        // The built-in MJPEG encoder splits each frame into stripes encoded in parallel
+        writer.set(cv::VIDEOWRITER_PROP_NSTRIPES, threads);
+    }
+
+    stopping = false;
+    fpsEstimate = 0.0;
+    encodedCount = 0;
+    running = true;
+    worker = std::thread(&VideoEncoder::run, this);
+
+    qDebug() << "VideoEncoder: writing" << formatName(codec) << "to" << path;
+    return true;
+}
+
+void VideoEncoder::write(const cv::Mat &frame)
+{
+    if (!running || frame.empty()) return;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    notFull.wait(lock, [this]() { return static_cast<int>(pending.size()) < capacity || stopping; });
+    if (stopping) return;
+
+    cv::Mat buffer;
+    if (!freeBuffers.empty()) {
+        buffer = freeBuffers.back();
+        freeBuffers.pop_back();
+    }
+    lock.unlock();
+
+    frame.copyTo(buffer); // Reuses the recycled allocation when the size matches
+
+    lock.lock();
+    pending.push_back(buffer);
+    lock.unlock();
+    notEmpty.notify_one();
+}
+
+int VideoEncoder::queueDepth() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return static_cast<int>(pending.size());
+}
+
+void VideoEncoder::close()
+{
+    if (!running) return;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    notEmpty.notify_all();
+    notFull.notify_all();
+
+    if (worker.joinable()) {
+        worker.join();
+    }
+
+    writer.release();
+    pending.clear();
+    freeBuffers.clear();
+    running = false;
+    qDebug() << "VideoEncoder: closed after" << encodedCount.load() << "frames";
+}
+
+void VideoEncoder::run()
+{
+    for (;;) {
+        cv::Mat frame;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            notEmpty.wait(lock, [this]() { return !pending.empty() || stopping; });
+            if (pending.empty()) {
+                return; // Stopping and fully drained
+            }
+            frame = pending.front();
+            pending.pop_front();
+        }
+        notFull.notify_one();
+
+        auto start = std::chrono::steady_clock::now();
+        writer.write(frame);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        // Exponential moving average of the instantaneous encode rate
+        double seconds = std::max(elapsed.count(), 1e-6);
+        double previous = fpsEstimate.load();
+        double instant = 1.0 / seconds;
+        fpsEstimate = (previous <= 0.0) ? instant : 0.9 * previous + 0.1 * instant;
+        ++encodedCount;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        freeBuffers.push_back(frame);
+    }
+}
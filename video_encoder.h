@@ -0,0 +1,67 @@
+#ifndef VIDEO_ENCODER_H
+#define VIDEO_ENCODER_H
+
+#include <QString>
+#include <QStringList>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+enum class VideoCodec {
+    MJPG,   // Motion JPEG in AVI (OpenCV built-in writer)
+    FFV1,   // Lossless FFV1 in MKV (FFmpeg backend)
+    H264,   // H.264 in MP4 (FFmpeg backend)
+    RAW     // Uncompressed frames in AVI (FFmpeg backend)
+};
+
+// Encodes frames on its own thread so cv::VideoWriter::write never adds to the
+// frame latency of the processing loop. write() copies the frame into a recycled
+// buffer and returns immediately unless the bounded queue is full, in which case
+// it blocks until the encoder catches up (back-pressure instead of dropping frames).
+class VideoEncoder
+{
+public:
+    explicit VideoEncoder(int queueCapacity = 8);
+    ~VideoEncoder();
+
+    bool open(const QString &path, VideoCodec codec, double fps, const cv::Size &frameSize, int threads = 0);
+    void write(const cv::Mat &frame);
+    void close(); // Drains the queue, then finalizes the file
+
+    bool isOpened() const { return running; }
+    int queueDepth() const;
+    int queueCapacity() const { return capacity; }
+    double encodeFps() const { return fpsEstimate.load(); }
+    long long framesEncoded() const { return encodedCount.load(); }
+
+    static VideoCodec codecFromFormat(const QString &format);
+    static QString formatName(VideoCodec codec);
+    static QString containerExtension(VideoCodec codec);
+    static QStringList formatNames();
+
+private:
+    void run();
+
+    cv::VideoWriter writer;
+    std::thread worker;
+    mutable std::mutex mutex;
+    std::condition_variable notEmpty;
+    std::condition_variable notFull;
+    std::deque<cv::Mat> pending;
+    std::vector<cv::Mat> freeBuffers;
+
+    int capacity;
+    bool stopping;
+    std::atomic<bool> running;
+    std::atomic<double> fpsEstimate;
+    std::atomic<long long> encodedCount;
+};
+
+#endif // VIDEO_ENCODER_H
@@ -1,13 +1,21 @@
 #include "controller.h"
 #include "video_player.h"
 #include <QMessageBox>
+#include <QFileInfo>
+#include <QDir>
+#include <QFontDatabase>
 #include <QDebug>
 #include <cmath> // Include cmath for pow function
+#include <algorithm>
 
+// Memory budgets for the scrubbing caches
+static const size_t DECODED_CACHE_BYTES = 256u * 1024u * 1024u;
+static const size_t PROCESSED_CACHE_BYTES = 512u * 1024u * 1024u;
 
 VideoPlayer::VideoPlayer(QWidget *parent)
     : QMainWindow(parent), isPaused(false), isPlaying(false),
-    controller(nullptr) { // Initialize shouldResize
+    controller(nullptr), decodedCache(DECODED_CACHE_BYTES),
+    processedCache(PROCESSED_CACHE_BYTES), resumeFrame(-1) { // Initialize shouldResize
     setWindowTitle("Imaging Instruments - VideoProcessor");
     setupUI();
     setFixedSize(1200, 800);
@@ -48,6 +56,29 @@ void VideoPlayer::setupVideoView() {
     videoView->setScene(videoScene);
     videoView->setRenderHint(QPainter::Antialiasing);
     videoView->setAlignment(Qt::AlignCenter);
+
+    // Per-stage latency overlay, toggled from the controls
+    hudItem = videoScene->addText("");
+    hudItem->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+    hudItem->setDefaultTextColor(QColor("#00FF7F"));
+    hudItem->setZValue(1);
+    hudItem->setPos(8, 8);
+    hudItem->setVisible(false);
+
+    // Track viewport resizes so the display path always decimates to the visible size
+    videoView->viewport()->installEventFilter(this);
+    updateDisplaySize();
+}
+
+void VideoPlayer::updateDisplaySize() {
+    displaySize = videoView->viewport()->size();
+}
+
+bool VideoPlayer::eventFilter(QObject *watched, QEvent *event) {
+    if (watched == videoView->viewport() && event->type() == QEvent::Resize) {
+        updateDisplaySize();
+    }
+    return QMainWindow::eventFilter(watched, event);
 }
 
 
@@ -101,13 +132,41 @@ void VideoPlayer::setupControls() {
     sliderLayout->addSpacing(15); // Space
 
     controlsLayout->addLayout(sliderLayout); // Now sliderLayout is managed by controlsLayout
+
+    hudCheckbox = new QCheckBox("Performance HUD", this);
+    controlsLayout->addWidget(hudCheckbox);
+
+    histogramCheckbox = new QCheckBox("Histogram", this);
+    controlsLayout->addWidget(histogramCheckbox);
+    histogramPanel = new HistogramWidget(this);
+    histogramPanel->setBgr(true);
+    histogramPanel->setMinimumHeight(180);
+    histogramPanel->setVisible(false);
+    controlsLayout->addWidget(histogramPanel);
     controlsLayout->addStretch(); // Push the time label to the bottom
 
+    // Seek slider, in frames; scrubbing is served from the frame caches when possible
+    seekSlider = createSlider(0, 0);
+    seekSlider->setEnabled(false);
+    controlsLayout->addWidget(seekSlider);
+
     // Time label
     timeLabel = new QLabel("00:00 / 00:00", this);
     timeLabel->setAlignment(Qt::AlignCenter);
     controlsLayout->addWidget(timeLabel);
 
+    // Tiles re-filtered in the last frame (incremental mode only)
+    tilesLabel = new QLabel("", this);
+    tilesLabel->setAlignment(Qt::AlignCenter);
+    tilesLabel->setVisible(false);
+    controlsLayout->addWidget(tilesLabel);
+
+    // Background encoder queue depth and throughput (only while saving)
+    encoderLabel = new QLabel("", this);
+    encoderLabel->setAlignment(Qt::AlignCenter);
+    encoderLabel->setVisible(false);
+    controlsLayout->addWidget(encoderLabel);
+
     // Status label
     statusLabel = new QLabel();
     statusLabel->setStyleSheet("color: white; font-size: 24px; background: transparent; padding: 10px;");
@@ -224,6 +283,12 @@ void VideoPlayer::setupConnections() {
     connect(playButton, &QPushButton::clicked, this, &VideoPlayer::playVideo);
     connect(pauseButton, &QPushButton::clicked, this, &VideoPlayer::pauseVideo);
     connect(stopButton, &QPushButton::clicked, this, &VideoPlayer::stopVideo);
+    connect(seekSlider, &QSlider::valueChanged, this, &VideoPlayer::seekToFrame);
+    connect(hudCheckbox, &QCheckBox::toggled, this, [this](bool checked) {
+        hudItem->setVisible(checked);
+        updateHud();
+    });
+    connect(histogramCheckbox, &QCheckBox::toggled, histogramPanel, &QWidget::setVisible);
 
     // Modified connection for the return button
     connect(returnButton, &QPushButton::clicked, this, [this]() {
@@ -239,6 +304,8 @@ void VideoPlayer::onReturnButtonClicked() {
 
     // Clear the video item and reset everything
     videoItem->setPixmap(QPixmap());
+    decodedCache.clear();
+    processedCache.clear();
     redAdjustment = 0;
     greenAdjustment = 0;
     blueAdjustment = 0;
@@ -268,6 +335,7 @@ void VideoPlayer::adjustBrightness(int value, int channel) {
     case 0: blueAdjustment = value; break;  // Blue channel adjustment
 
     }
+    processedCache.clear(); // Cached results no longer match the adjustments
 }
 
 
@@ -278,20 +346,20 @@ void VideoPlayer::adjustGamma(int value) {
 void VideoPlayer::loadVideo(const QString &filePath) {
     qDebug() << "Loading video from:" << filePath;
 
-    cap.open(filePath.toStdString());
-    if (!cap.isOpened()) {
+    std::unique_ptr<FrameSource> decoder = FrameSource::create(filePath);
+    if (!decoder) {
         QMessageBox::warning(this, "Error", "Could not open video file.");
         qDebug() << "Failed to open video file.";
         return;
     }
+    source.reset(new PrefetchingFrameSource(std::move(decoder)));
+    controller->logMessage("Frame source: " + source->description(), STATUS_MSG);
 
-    frameWidth = static_cast<int>(cap.get(cv::CAP_PROP_FRAME_WIDTH));
-    frameHeight = static_cast<int>(cap.get(cv::CAP_PROP_FRAME_HEIGHT));
+    frameWidth = source->frameSize().width;
+    frameHeight = source->frameSize().height;
 
     // Get total time of the video in seconds
-    double fps = cap.get(cv::CAP_PROP_FPS);
-    double frameCount = cap.get(cv::CAP_PROP_FRAME_COUNT);
-    totalTime = frameCount / fps; // Total time in seconds
+    totalTime = source->durationSeconds();
 
     // Format total time for display
     int totalMinutes = static_cast<int>(totalTime) / 60;
@@ -300,7 +368,23 @@ void VideoPlayer::loadVideo(const QString &filePath) {
                            .arg(totalMinutes, 2, 10, QChar('0'))
                            .arg(totalSeconds, 2, 10, QChar('0')));
 
+    decodedCache.clear();
+    processedCache.clear();
+    resumeFrame = -1;
+    telemetry.reset();
+    int frames = source->frameCount();
+    seekSlider->setEnabled(frames > 1);
+    {
+        QSignalBlocker blocker(seekSlider);
+        seekSlider->setRange(0, std::max(0, frames - 1));
+        seekSlider->setValue(0);
+    }
+
     isPlaying = false;
+    incrementalFilter.reset();
+    frameStacker.reset();
+    controller->resetColorEnhancementState();
+    tilesLabel->setVisible(controller->isIncrementalFilteringEnabled());
 
     if (controller->isSaveEnabled()){
         initializeVideoWriter();
@@ -315,6 +399,9 @@ void VideoPlayer::playVideo() {
     qDebug() << "Attempting to play video...";
     if (!isPlaying && !isPaused) {
         isPlaying = true;
+        if (controller->isSaveEnabled() && !videoEncoder.isOpened()) {
+            initializeVideoWriter(); // Restarting after stop begins a new export
+        }
         if (timer) {
             timer->start(30); // Start the timer to process frames
             if (statusLabel) {
@@ -343,7 +430,16 @@ void VideoPlayer::stopVideo() {
     isPlaying = false; // Ensure not playing
     isPaused = false; // Reset the paused state
     timer->stop(); // Stop the timer
-    cap.set(cv::CAP_PROP_POS_FRAMES, 0); // Reset to the first frame
+    if (source) {
+        source->rewind(); // Reset to the first frame and restart prefetching
+    }
+    resumeFrame = -1;
+    updateSeekSlider(0);
+    incrementalFilter.reset();
+    frameStacker.reset();
+    controller->resetColorEnhancementState();
+
+    finishExport();
     videoItem->setPixmap(QPixmap()); // Clear the current frame display
 
     // Reset elapsed time to 0
@@ -360,89 +456,255 @@ void VideoPlayer::stopVideo() {
 void VideoPlayer::processFrame() {
     if (!isPlaying || isPaused) return;
 
-    cv::Mat frame;
-    if (cap.read(frame)) {
-        // Log frame reading status
+    // A cached seek moved the playhead without touching the decoder
+    if (source && resumeFrame >= 0) {
+        if (source->position() != resumeFrame) {
+            source->seek(resumeFrame);
+        }
+        resumeFrame = -1;
+    }
+
+    telemetry.beginFrame(source ? source->position() : 0);
+    bool frameRead;
+    {
+        FrameTelemetry::Stage stage(telemetry, "decode");
+        frameRead = source && source->read(currentFrame);
+    }
+
+    if (frameRead) {
+        int frameNumber = source->position() - 1;
         controller->logMessage("Frame read successfully.", STATUS_MSG);
 
-        // Get the original frame
-        cv::Mat originalFrame = frame.clone();
+        // currentFrame goes back into the prefetch ring on the next read, so cache a copy
+        decodedCache.insert(frameNumber, currentFrame.clone());
 
-        // Update the controller's inputImage with the current frame
-        controller->getModel()->inputImage = frame.clone();
+        cv::Mat processedFrame = processImage(currentFrame);
+        processedCache.insert(frameNumber, processedFrame);
 
-        // Apply filters based on checkbox states in the controller
-        if (controller->isVectorFilterEnabled()) {
-            controller->applyVectorFilter();
-            controller->logMessage("Vector filter applied.", STATUS_MSG);
+        // Check if saving is enabled in the controller
+        if (controller->isSaveEnabled() && videoEncoder.isOpened()) {
+            controller->logMessage("Queueing frame for the encoder.", STATUS_MSG);
+            FrameTelemetry::Stage stage(telemetry, "encode"); // Includes waiting on a full queue
+            videoEncoder.write(processedFrame);  // Copied and encoded on the encoder thread
+            updateEncoderLabel();
+        } else {
+            controller->logMessage("Video writer not opened or save not enabled.", STATUS_MSG);
         }
-        if (controller->isColorEnhancementEnabled()) {
-            controller->applyColorEnhancement();
-            controller->logMessage("Color enhancement applied.", STATUS_MSG);
+
+        // Display the processed frame
+        {
+            FrameTelemetry::Stage stage(telemetry, "display");
+            showFrame(processedFrame);
+        }
+        telemetry.endFrame();
+
+        updateTimeLabel(frameNumber);
+        updateSeekSlider(frameNumber);
+        if (hudItem->isVisible() && telemetry.framesTimed() % 10 == 0) {
+            updateHud();
         }
+    } else {
+        controller->logMessage("No more frames to read. Stopping video.", STATUS_MSG);
+        stopVideo();
+    }
+}
 
-        // Get the processed image from the model (still at original size)
-        cv::Mat processedFrame = controller->getModel()->inputImage.clone();
+cv::Mat VideoPlayer::processImage(const cv::Mat &frame) {
+    ImagingInstrumentsModel *model = controller->getModel();
 
-        // Adjust the channels
-        std::vector<cv::Mat> channels(3);
-        cv::split(processedFrame, channels);
+    // Update the controller's inputImage with the current frame
+    model->setInputImage(frame.clone());
 
-        channels[2].convertTo(channels[2], CV_8UC1, 1, redAdjustment);   // Red channel
-        channels[1].convertTo(channels[1], CV_8UC1, 1, greenAdjustment); // Green channel
-        channels[0].convertTo(channels[0], CV_8UC1, 1, blueAdjustment);  // Blue channel
+    // The clip's ROI stands in for the image's while the instruments run
+    cv::Rect imageRoi = model->getRoi();
+    QRect videoRoi = controller->getVideoRoi();
+    model->setRoi(cv::Rect(videoRoi.x(), videoRoi.y(), videoRoi.width(), videoRoi.height()));
+
+    // Temporal stacking runs first so the spatial instruments see the denoised frame
+    if (controller->isStackingEnabled()) {
+        FrameTelemetry::Stage stage(telemetry, "stacking");
+        applyFrameStacking(frame);
+    }
 
-        // Clamp values to the range [0, 255]
-        for (int i = 0; i < 3; ++i) {
-            cv::threshold(channels[i], channels[i], 0, 255, cv::THRESH_TOZERO);
-            cv::threshold(channels[i], channels[i], 255, 255, cv::THRESH_TRUNC);
+    // Apply filters based on checkbox states in the controller
+    if (controller->isVectorFilterEnabled()) {
+        FrameTelemetry::Stage stage(telemetry, "vector filter");
+        if (controller->isIncrementalFilteringEnabled()) {
+            applyIncrementalVectorFilter();
+        } else {
+            controller->applyVectorFilter();
+            controller->logMessage("Vector filter applied.", STATUS_MSG);
         }
+    }
+    if (controller->isColorEnhancementEnabled()) {
+        FrameTelemetry::Stage stage(telemetry, "color enhancement");
+        controller->applyColorEnhancement("claheVideo");
+        controller->logMessage("Color enhancement applied.", STATUS_MSG);
+    }
 
-        // Merge channels back
-        cv::merge(channels, processedFrame);
+    model->setRoi(imageRoi);
 
-        // Use the processed frame directly without resizing
-        cv::Mat resizedFrame = processedFrame.clone();
+    FrameTelemetry::Stage stage(telemetry, "color adjust");
 
-        // Check if saving is enabled in the controller
-        if (controller->isSaveEnabled() && videoWriter.isOpened()) {
-            controller->logMessage("Writing frame to disk.", STATUS_MSG);
-            videoWriter.write(resizedFrame);  // Write the processed frame
-        } else {
-            controller->logMessage("Video writer not opened or save not enabled.", STATUS_MSG);
+    // Get the processed image from the model (still at original size)
+    cv::Mat processedFrame = model->inputImage.clone();
+
+    // Adjust the channels
+    std::vector<cv::Mat> channels(3);
+    cv::split(processedFrame, channels);
+
+    channels[2].convertTo(channels[2], CV_8UC1, 1, redAdjustment);   // Red channel
+    channels[1].convertTo(channels[1], CV_8UC1, 1, greenAdjustment); // Green channel
+    channels[0].convertTo(channels[0], CV_8UC1, 1, blueAdjustment);  // Blue channel
+
+    // Clamp values to the range [0, 255]
+    for (int i = 0; i < 3; ++i) {
+        cv::threshold(channels[i], channels[i], 0, 255, cv::THRESH_TOZERO);
+        cv::threshold(channels[i], channels[i], 255, 255, cv::THRESH_TRUNC);
+    }
+
+    // Merge channels back
+    cv::merge(channels, processedFrame);
+    return processedFrame;
+}
+
+void VideoPlayer::seekToFrame(int frameNumber) {
+    if (!source || frameNumber < 0) return;
+
+    cv::Mat processed;
+    if (!processedCache.find(frameNumber, processed)) {
+        cv::Mat decoded;
+        if (!decodedCache.find(frameNumber, decoded)) {
+            // Cache miss: the source seeks from the nearest indexed keyframe
+            if (!source->seek(frameNumber) || !source->read(currentFrame)) {
+                controller->logMessage("Seek to frame " + QString::number(frameNumber) + " failed.", ERROR_MSG);
+                return;
+            }
+            decoded = currentFrame.clone();
+            decodedCache.insert(frameNumber, decoded);
         }
 
-        // Display the processed frame
-        cv::cvtColor(resizedFrame, resizedFrame, cv::COLOR_BGR2RGB);
-        QImage img = QImage(resizedFrame.data, resizedFrame.cols, resizedFrame.rows, resizedFrame.step[0], QImage::Format_RGB888);
-        QPixmap pixmap = QPixmap::fromImage(img);
-
-        QSize viewSize = videoView->size();
-        QSize pixmapSize = pixmap.size();
-        qreal scaleX = static_cast<qreal>(viewSize.width()) / pixmapSize.width();
-        qreal scaleY = static_cast<qreal>(viewSize.height()) / pixmapSize.height();
-        qreal scale = qMin(scaleX, scaleY);
-
-        videoItem->setPixmap(pixmap.scaled(pixmapSize * scale, Qt::KeepAspectRatio, Qt::SmoothTransformation));
-
-        // Update time label
-        double currentTime = cap.get(cv::CAP_PROP_POS_MSEC) / 1000.0;
-        int elapsedSeconds = static_cast<int>(currentTime);
-        int totalSeconds = static_cast<int>(totalTime);
-
-        timeLabel->setText(QString("%1:%2 / %3:%4")
-                               .arg(elapsedSeconds / 60, 2, 10, QChar('0'))
-                               .arg(elapsedSeconds % 60, 2, 10, QChar('0'))
-                               .arg(totalSeconds / 60, 2, 10, QChar('0'))
-                               .arg(totalSeconds % 60, 2, 10, QChar('0')));
-    } else {
-        controller->logMessage("No more frames to read. Stopping video.", STATUS_MSG);
-        stopVideo();
+        incrementalFilter.reset(); // Temporal state does not carry across a jump
+        frameStacker.reset();
+        controller->resetColorEnhancementState();
+        processed = processImage(decoded);
+        processedCache.insert(frameNumber, processed);
     }
+
+    resumeFrame = frameNumber + 1;
+    showFrame(processed);
+    updateTimeLabel(frameNumber);
+}
+
+void VideoPlayer::updateTimeLabel(int frameNumber) {
+    double currentTime = (frameNumber + 1) / source->fps();
+    int elapsedSeconds = static_cast<int>(currentTime);
+    int totalSeconds = static_cast<int>(totalTime);
+
+    timeLabel->setText(QString("%1:%2 / %3:%4")
+                           .arg(elapsedSeconds / 60, 2, 10, QChar('0'))
+                           .arg(elapsedSeconds % 60, 2, 10, QChar('0'))
+                           .arg(totalSeconds / 60, 2, 10, QChar('0'))
+                           .arg(totalSeconds % 60, 2, 10, QChar('0')));
+}
+
+void VideoPlayer::updateSeekSlider(int frameNumber) {
+    // Follow playback without triggering a seek
+    QSignalBlocker blocker(seekSlider);
+    seekSlider->setValue(frameNumber);
 }
 
 
 
+void VideoPlayer::applyFrameStacking(const cv::Mat &frame) {
+    frameStacker.setMode(FrameStacker::modeFromName(controller->getStackingMode()));
+    frameStacker.setWindow(controller->getStackingWindow());
+
+    cv::Mat stacked;
+    if (!frameStacker.process(frame, stacked)) {
+        controller->logMessage("Temporal stacking failed.", ERROR_MSG);
+        return;
+    }
+    controller->getModel()->setInputImage(stacked);
+
+    cv::Point2d shift = frameStacker.lastShift();
+    controller->logMessage(QString("Stacked %1 frames, shift (%2, %3), response %4")
+                               .arg(frameStacker.stackedFrames())
+                               .arg(shift.x, 0, 'f', 2)
+                               .arg(shift.y, 0, 'f', 2)
+                               .arg(frameStacker.lastResponse(), 0, 'f', 3), STATUS_MSG);
+}
+
+void VideoPlayer::applyIncrementalVectorFilter() {
+    ImagingInstrumentsModel *model = controller->getModel();
+    bool useGpu = controller->isCudaAvailable();
+
+    incrementalFilter.setThreshold(controller->getChangeThreshold());
+    incrementalFilter.setRefreshInterval(controller->getRefreshInterval());
+
+    // With a fixed ROI only a view of that part of the frame is tracked and filtered
+    model->beginRoi(2); // The vector filter's window reach
+    cv::Mat filtered;
+    bool ok = incrementalFilter.process(model->inputImage, filtered, [model, useGpu](const cv::Mat &input, cv::Mat &output) {
+        return model->runVectorFilter(input, output, useGpu);
+    });
+
+    if (!ok) {
+        model->endRoi(cv::Mat());
+        controller->logMessage("Incremental vector filter failed.", ERROR_MSG);
+        return;
+    }
+
+    model->setInputImage(model->endRoi(filtered));
+
+    QString tilesText = QString("Tiles: %1 / %2")
+                            .arg(incrementalFilter.tilesReprocessed())
+                            .arg(incrementalFilter.tileCount());
+    tilesLabel->setText(tilesText);
+    controller->logMessage("Incremental vector filter applied. " + tilesText, STATUS_MSG);
+}
+
+void VideoPlayer::showFrame(const cv::Mat &frame) {
+    if (frame.empty()) return;
+
+    // Processed frames are never written again, so the panel can share them
+    if (histogramPanel->isVisible()) {
+        histogramPanel->updateHistogram(frame);
+    }
+    if (displaySize.isEmpty()) {
+        updateDisplaySize();
+        if (displaySize.isEmpty()) return;
+    }
+
+    // Fit the frame inside the viewport, keeping its aspect ratio
+    double scale = std::min(static_cast<double>(displaySize.width()) / frame.cols,
+                            static_cast<double>(displaySize.height()) / frame.rows);
+    cv::Size target(std::max(1, cvRound(frame.cols * scale)),
+                    std::max(1, cvRound(frame.rows * scale)));
+
+    // Downscale first so the color conversion only touches the pixels that are shown.
+    // cv::Mat::create keeps the existing allocation while the target size is unchanged.
+    if (target == frame.size()) {
+        cv::cvtColor(frame, displayRGB, cv::COLOR_BGR2RGB);
+    } else {
+        int interpolation = (scale < 1.0) ? cv::INTER_AREA : cv::INTER_LINEAR;
+        cv::resize(frame, displayBGR, target, 0, 0, interpolation);
+        cv::cvtColor(displayBGR, displayRGB, cv::COLOR_BGR2RGB);
+    }
+
+    // Only rebuild the QImage header when the backing buffer moved or changed size
+    if (displayImage.constBits() != displayRGB.data
+        || displayImage.width() != displayRGB.cols
+        || displayImage.height() != displayRGB.rows) {
+        displayImage = QImage(displayRGB.data, displayRGB.cols, displayRGB.rows,
+                              static_cast<int>(displayRGB.step[0]), QImage::Format_RGB888);
+    }
+
+    // Drop the item's reference first so convertFromImage can reuse the pixmap storage
+    videoItem->setPixmap(QPixmap());
+    displayPixmap.convertFromImage(displayImage, Qt::NoFormatConversion);
+    videoItem->setPixmap(displayPixmap);
+}
 
 void VideoPlayer::updateStatusLabel(const QString &text) {
     if (statusLabel) {
@@ -460,26 +722,73 @@ void VideoPlayer::setOutputPath(const QString &path) {
 
 void VideoPlayer::initializeVideoWriter() {
 
-    controller->logMessage("Output path for video writer: " + outputPath, STATUS_MSG);
+    if (outputPath.isEmpty()) {
+        outputPath = controller->getOutputPath();
+    }
+
+    VideoCodec codec = VideoEncoder::codecFromFormat(controller->getVideoFormat());
 
-    // Set codec and other parameters
-    int codec = cv::VideoWriter::fourcc('M', 'J', 'P', 'G'); // Use MJPG codec
-    double fps = cap.get(cv::CAP_PROP_FPS); // Get the frame rate from the input video
+    // Make sure the file name matches the container of the selected codec
+    QString path = outputPath;
+    QFileInfo info(path);
+    if (info.isDir()) {
+        path = QDir(path).filePath("imaging_instruments_output");
+        info = QFileInfo(path);
+    }
+    QString extension = VideoEncoder::containerExtension(codec);
+    if (info.suffix().compare(extension, Qt::CaseInsensitive) != 0) {
+        path = info.path() + "/" + info.completeBaseName() + "." + extension;
+    }
 
-    // Get the original frame dimensions
-    int originalWidth = cap.get(cv::CAP_PROP_FRAME_WIDTH);
-    int originalHeight = cap.get(cv::CAP_PROP_FRAME_HEIGHT);
+    controller->logMessage("Output path for video writer: " + path, STATUS_MSG);
+    exportPath = path;
 
-    // Attempt to open the video writer with the original size
-    videoWriter.open(outputPath.toStdString(), codec, fps, cv::Size(originalWidth, originalHeight), true);
+    if (!source) {
+        controller->logMessage("Error: no frame source to size the video writer.", ERROR_MSG);
+        return;
+    }
 
-    if (!videoWriter.isOpened()) {
+    double fps = source->fps(); // Frame rate and dimensions of the input
+    if (!videoEncoder.open(path, codec, fps, source->frameSize(), controller->getEncoderThreads())) {
         controller->logMessage("Error: Could not open the video writer!", ERROR_MSG);
+        encoderLabel->setVisible(false);
     } else {
-        controller->logMessage("Video writer opened successfully.", STATUS_MSG);
+        controller->logMessage("Video writer opened successfully: " + VideoEncoder::formatName(codec), STATUS_MSG);
+        telemetry.startRecording(); // The CSV covers exactly the frames of this export
+        encoderLabel->setVisible(true);
+        updateEncoderLabel();
     }
 }
 
+void VideoPlayer::finishExport() {
+    if (!videoEncoder.isOpened()) return;
+
+    videoEncoder.close(); // Drain the queue and finalize the file
+    controller->logMessage("Encoder closed after " + QString::number(videoEncoder.framesEncoded()) + " frames.", STATUS_MSG);
+
+    // Per-frame stage timings next to the exported video
+    QFileInfo info(exportPath);
+    QString csvPath = info.path() + "/" + info.completeBaseName() + "_telemetry.csv";
+    if (telemetry.writeCsv(csvPath)) {
+        controller->logMessage("Frame telemetry written to " + csvPath, STATUS_MSG);
+    } else {
+        controller->logMessage("Could not write frame telemetry to " + csvPath, ERROR_MSG);
+    }
+    telemetry.stopRecording();
+}
+
+void VideoPlayer::updateHud() {
+    if (!hudItem->isVisible()) return;
+    hudItem->setPlainText(telemetry.framesTimed() > 0 ? telemetry.summary() : "Waiting for frames...");
+}
+
+void VideoPlayer::updateEncoderLabel() {
+    encoderLabel->setText(QString("Encoder: queue %1/%2, %3 fps")
+                              .arg(videoEncoder.queueDepth())
+                              .arg(videoEncoder.queueCapacity())
+                              .arg(videoEncoder.encodeFps(), 0, 'f', 1));
+}
+
 
 
 void VideoPlayer::showOutputPathDialog() {
@@ -510,7 +819,8 @@ void VideoPlayer::closeEvent(QCloseEvent *event) {
         timer->stop(); // Stop the QTimer
     }
 
-    cap.release(); // Release the video capture resource
+    source.reset(); // Stop the prefetch thread and release the decoder
+    finishExport(); // Flush any queued frames to disk
 
 
     controller->logMessage("Window is closing, video processing stopped." + outputPath, STATUS_MSG);
@@ -592,6 +902,7 @@ void VideoPlayer::applyTheme(const QString &theme) {
     redSlider->setStyleSheet(sliderStyle.arg(sliderBackground, sliderHandleColor, borderColor));
     greenSlider->setStyleSheet(sliderStyle.arg(sliderBackground, sliderHandleColor, borderColor));
     blueSlider->setStyleSheet(sliderStyle.arg(sliderBackground, sliderHandleColor, borderColor));
+    seekSlider->setStyleSheet(sliderStyle.arg(sliderBackground, sliderHandleColor, borderColor));
 }
 
 
@@ -21,6 +21,13 @@
 
 //#include "controller.h"
 #include "video_settings.h"
+#include "incremental_filter.h"
+#include "video_encoder.h"
+#include "frame_source.h"
+#include "frame_cache.h"
+#include "frame_telemetry.h"
+#include "frame_stacker.h"
+#include "histogram_widget.h"
 
 
 class ImagingInstrumentsController; // Forward declaration
@@ -54,15 +61,26 @@ private:
     QSlider *greenSlider;
     QSlider *blueSlider;
     QSlider *gammaSlider;
+    QSlider *seekSlider;
     QLabel *timeLabel;
     QLabel *statusLabel;
+    QLabel *tilesLabel;
+    QLabel *encoderLabel;
+    QCheckBox *hudCheckbox;
+    QGraphicsTextItem *hudItem; // Performance overlay drawn over the video
+    QCheckBox *histogramCheckbox;
+    HistogramWidget *histogramPanel; // Live histogram of the displayed frames
 
     // Layouts
     QVBoxLayout *controlsLayout;
     QGraphicsTextItem *statusLabelItem;
 
     // Video processing variables
-    cv::VideoCapture cap;
+    std::unique_ptr<FrameSource> source; // Prefetched; decodes ahead of processFrame
+    cv::Mat currentFrame;                // Swapped with the prefetch ring on every read
+    FrameCache decodedCache;             // Source frames, for reprocessing after a seek
+    FrameCache processedCache;           // Displayed frames, for instant scrubbing
+    int resumeFrame;                     // Where playback continues after a cached seek, -1 if in sync
     QTimer *timer;
     bool isPlaying;
     bool isPaused;
@@ -81,7 +99,12 @@ private:
     int frameCounter;
 
     void initializeVideoWriter();
-    cv::VideoWriter videoWriter;
+    void finishExport();
+    void updateEncoderLabel();
+    void updateHud();
+    FrameTelemetry telemetry;
+    QString exportPath; // File being written by videoEncoder
+    VideoEncoder videoEncoder;
     int frameWidth;              // Declare frameWidth
     int frameHeight;
     void showOutputPathDialog();
@@ -93,6 +116,25 @@ private:
     QLabel *greenLabel;
     QLabel *blueLabel;
 
+    IncrementalFilter incrementalFilter;
+    FrameStacker frameStacker;
+    void applyFrameStacking(const cv::Mat &frame);
+    void applyIncrementalVectorFilter();
+    cv::Mat processImage(const cv::Mat &frame);
+    void seekToFrame(int frameNumber);
+    void updateTimeLabel(int frameNumber);
+    void updateSeekSlider(int frameNumber);
+
+    // Display path: frames are decimated to the viewport before color conversion,
+    // and the buffers below are reused from frame to frame
+    cv::Mat displayBGR;
+    cv::Mat displayRGB;
+    QImage displayImage;
+    QPixmap displayPixmap;
+    QSize displaySize;
+    void updateDisplaySize();
+    void showFrame(const cv::Mat &frame);
+
 public slots:
     void applyTheme(const QString &theme);
 
@@ -121,6 +163,7 @@ private slots:
 
 protected:
     void closeEvent(QCloseEvent *event) override;
+    bool eventFilter(QObject *watched, QEvent *event) override;
 
 };
 
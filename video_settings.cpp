@@ -1,4 +1,6 @@
 #include "video_settings.h"
+#include "video_encoder.h"
+#include "frame_stacker.h"
 #include <QDebug>
 #include <QFont>
 #include <QStandardPaths>
@@ -7,19 +9,54 @@ VideoSettings::VideoSettings(QWidget *parent)
     : QDialog(parent),
     pathEdit(new QLineEdit(this)),
     formatComboBox(new QComboBox(this)),
+    encoderThreadsSpinBox(new QSpinBox(this)),
     okButton(new QPushButton("OK", this)),
     cancelButton(new QPushButton("Cancel", this)),
     selectButton(new QPushButton("Output", this)),
     saveCheckBox(new QCheckBox("Save", this)),
     vectorFilterCheckbox(new QCheckBox("α-Trimmed Vector Median Filter", this)),
-    colorEnhancementCheckbox(new QCheckBox("Color Enhancement", this))
+    colorEnhancementCheckbox(new QCheckBox("Color Enhancement", this)),
+    incrementalCheckbox(new QCheckBox("Incremental (skip static regions)", this)),
+    thresholdSpinBox(new QDoubleSpinBox(this)),
+    refreshSpinBox(new QSpinBox(this)),
+    stackingCheckbox(new QCheckBox("Temporal stacking (aligned)", this)),
+    stackingModeComboBox(new QComboBox(this)),
+    stackingWindowSpinBox(new QSpinBox(this)),
+    roiCheckbox(new QCheckBox("Region of interest", this)),
+    roiXSpinBox(new QSpinBox(this)),
+    roiYSpinBox(new QSpinBox(this)),
+    roiWidthSpinBox(new QSpinBox(this)),
+    roiHeightSpinBox(new QSpinBox(this))
 {
     // Set default path to the Videos folder
     QString videosPath = QStandardPaths::writableLocation(QStandardPaths::MoviesLocation);
     pathEdit->setText(videosPath);
 
     // Setup format options
-    formatComboBox->addItems({"AVI", "MKV"});
+    formatComboBox->addItems(VideoEncoder::formatNames());
+    encoderThreadsSpinBox->setRange(0, 64);
+    encoderThreadsSpinBox->setValue(0);
+    encoderThreadsSpinBox->setSpecialValueText("Auto");
+
+    // Incremental filtering options
+    thresholdSpinBox->setRange(0.0, 255.0);
+    thresholdSpinBox->setSingleStep(0.5);
+    thresholdSpinBox->setValue(4.0);
+    refreshSpinBox->setRange(0, 10000);
+    refreshSpinBox->setValue(30);
+    refreshSpinBox->setSpecialValueText("Never");
+
+    // Temporal stacking options
+    stackingModeComboBox->addItems(FrameStacker::modeNames());
+    stackingWindowSpinBox->setRange(2, 64);
+    stackingWindowSpinBox->setValue(8);
+
+    // Region of interest, in frame pixels; clipped to the frame when applied
+    for (QSpinBox *spinBox : { roiXSpinBox, roiYSpinBox, roiWidthSpinBox, roiHeightSpinBox }) {
+        spinBox->setRange(0, 16384);
+    }
+    roiWidthSpinBox->setValue(640);
+    roiHeightSpinBox->setValue(480);
 
     // Layout setup
     QVBoxLayout *layout = new QVBoxLayout(this);
@@ -27,11 +64,43 @@ VideoSettings::VideoSettings(QWidget *parent)
     pathLayout->addWidget(pathEdit);
     pathLayout->addWidget(selectButton);
 
+    QHBoxLayout *incrementalLayout = new QHBoxLayout();
+    incrementalLayout->addWidget(incrementalCheckbox);
+    incrementalLayout->addWidget(new QLabel("Threshold", this));
+    incrementalLayout->addWidget(thresholdSpinBox);
+    incrementalLayout->addWidget(new QLabel("Refresh", this));
+    incrementalLayout->addWidget(refreshSpinBox);
+
+    QHBoxLayout *stackingLayout = new QHBoxLayout();
+    stackingLayout->addWidget(stackingCheckbox);
+    stackingLayout->addWidget(stackingModeComboBox);
+    stackingLayout->addWidget(new QLabel("Frames", this));
+    stackingLayout->addWidget(stackingWindowSpinBox);
+
+    QHBoxLayout *roiLayout = new QHBoxLayout();
+    roiLayout->addWidget(roiCheckbox);
+    roiLayout->addWidget(new QLabel("X", this));
+    roiLayout->addWidget(roiXSpinBox);
+    roiLayout->addWidget(new QLabel("Y", this));
+    roiLayout->addWidget(roiYSpinBox);
+    roiLayout->addWidget(new QLabel("W", this));
+    roiLayout->addWidget(roiWidthSpinBox);
+    roiLayout->addWidget(new QLabel("H", this));
+    roiLayout->addWidget(roiHeightSpinBox);
+
+    layout->addLayout(stackingLayout);
+    layout->addLayout(roiLayout);
     layout->addWidget(vectorFilterCheckbox);
+    layout->addLayout(incrementalLayout);
     layout->addWidget(colorEnhancementCheckbox);
     layout->addWidget(saveCheckBox);
     layout->addLayout(pathLayout);
-    layout->addWidget(formatComboBox);
+
+    QHBoxLayout *formatLayout = new QHBoxLayout();
+    formatLayout->addWidget(formatComboBox, 1);
+    formatLayout->addWidget(new QLabel("Encoder threads", this));
+    formatLayout->addWidget(encoderThreadsSpinBox);
+    layout->addLayout(formatLayout);
     layout->addWidget(okButton);
     layout->addWidget(cancelButton);
 
@@ -40,15 +109,27 @@ VideoSettings::VideoSettings(QWidget *parent)
     this->setFont(font);
     pathEdit->setFont(font);
     formatComboBox->setFont(font);
+    encoderThreadsSpinBox->setFont(font);
     okButton->setFont(font);
     cancelButton->setFont(font);
     selectButton->setFont(font);
     saveCheckBox->setFont(font);
     vectorFilterCheckbox->setFont(font);
     colorEnhancementCheckbox->setFont(font);
+    incrementalCheckbox->setFont(font);
+    thresholdSpinBox->setFont(font);
+    refreshSpinBox->setFont(font);
+    stackingCheckbox->setFont(font);
+    stackingModeComboBox->setFont(font);
+    stackingWindowSpinBox->setFont(font);
+    roiCheckbox->setFont(font);
+    roiXSpinBox->setFont(font);
+    roiYSpinBox->setFont(font);
+    roiWidthSpinBox->setFont(font);
+    roiHeightSpinBox->setFont(font);
 
     // Set fixed size of the dialog
-    setFixedSize(700, 300);
+    setFixedSize(700, 420);
 
     // Connect signals and slots
     connect(okButton, &QPushButton::clicked, this, &VideoSettings::acceptDialog);
@@ -56,12 +137,42 @@ VideoSettings::VideoSettings(QWidget *parent)
     connect(selectButton, &QPushButton::clicked, this, &VideoSettings::selectPath);
     connect(saveCheckBox, &QCheckBox::toggled, this, &VideoSettings::togglePathEdit);
     togglePathEdit(saveCheckBox->isChecked());
+
+    connect(vectorFilterCheckbox, &QCheckBox::toggled, incrementalCheckbox, &QCheckBox::setEnabled);
+    connect(incrementalCheckbox, &QCheckBox::toggled, this, &VideoSettings::toggleIncrementalSettings);
+    incrementalCheckbox->setEnabled(vectorFilterCheckbox->isChecked());
+    toggleIncrementalSettings(incrementalCheckbox->isChecked());
+
+    connect(stackingCheckbox, &QCheckBox::toggled, this, &VideoSettings::toggleStackingSettings);
+    toggleStackingSettings(stackingCheckbox->isChecked());
+
+    connect(roiCheckbox, &QCheckBox::toggled, this, &VideoSettings::toggleRoiSettings);
+    toggleRoiSettings(roiCheckbox->isChecked());
+}
+
+void VideoSettings::toggleStackingSettings(bool checked) {
+    stackingModeComboBox->setEnabled(checked);
+    stackingWindowSpinBox->setEnabled(checked);
+}
+
+void VideoSettings::toggleRoiSettings(bool checked) {
+    roiXSpinBox->setEnabled(checked);
+    roiYSpinBox->setEnabled(checked);
+    roiWidthSpinBox->setEnabled(checked);
+    roiHeightSpinBox->setEnabled(checked);
+}
+
+void VideoSettings::toggleIncrementalSettings(bool checked) {
+    thresholdSpinBox->setEnabled(checked);
+    refreshSpinBox->setEnabled(checked);
 }
 
 
 void VideoSettings::togglePathEdit(bool checked) {
     pathEdit->setEnabled(checked);
     selectButton->setEnabled(checked);
+    formatComboBox->setEnabled(checked);
+    encoderThreadsSpinBox->setEnabled(checked);
 }
 
 QString VideoSettings::getOutputPath() const {
@@ -74,6 +185,10 @@ QString VideoSettings::getSelectedFormat() const {
     return formatComboBox->currentText();
 }
 
+int VideoSettings::getEncoderThreads() const {
+    return encoderThreadsSpinBox->value();
+}
+
 bool VideoSettings::isVectorFilterEnabled() const {
     return vectorFilterCheckbox->isChecked(); // Return the state of the vector filter checkbox
 }
@@ -86,6 +201,37 @@ bool VideoSettings::isSaveEnabled() const {
     return saveCheckBox->isChecked();
 }
 
+bool VideoSettings::isIncrementalFilteringEnabled() const {
+    return vectorFilterCheckbox->isChecked() && incrementalCheckbox->isChecked();
+}
+
+double VideoSettings::getChangeThreshold() const {
+    return thresholdSpinBox->value();
+}
+
+int VideoSettings::getRefreshInterval() const {
+    return refreshSpinBox->value();
+}
+
+bool VideoSettings::isStackingEnabled() const {
+    return stackingCheckbox->isChecked();
+}
+
+QString VideoSettings::getStackingMode() const {
+    return stackingModeComboBox->currentText();
+}
+
+int VideoSettings::getStackingWindow() const {
+    return stackingWindowSpinBox->value();
+}
+
+QRect VideoSettings::getRoi() const {
+    if (!roiCheckbox->isChecked() || roiWidthSpinBox->value() == 0 || roiHeightSpinBox->value() == 0) {
+        return QRect();
+    }
+    return QRect(roiXSpinBox->value(), roiYSpinBox->value(), roiWidthSpinBox->value(), roiHeightSpinBox->value());
+}
+
 
 
 void VideoSettings::acceptDialog() {
@@ -103,7 +249,7 @@ void VideoSettings::acceptDialog() {
 
 
 void VideoSettings::selectPath() {
-    QString fileName = QFileDialog::getSaveFileName(this, "Select Output Path", QString(), "Videos (*.avi *.mkv)");
+    QString fileName = QFileDialog::getSaveFileName(this, "Select Output Path", QString(), "Videos (*.avi *.mkv *.mp4)");
     if (!fileName.isEmpty()) {
         pathEdit->setText(fileName);
         qDebug() << "Selected output path:" << fileName;
@@ -10,6 +10,9 @@
 #include <QMessageBox>
 #include <QFileDialog>
 #include <QCheckBox>
+#include <QSpinBox>
+#include <QDoubleSpinBox>
+#include <QLabel>
 
 class VideoSettings : public QDialog {
     Q_OBJECT
@@ -19,14 +22,26 @@ public:
 
     QString getOutputPath() const;
     QString getSelectedFormat() const;
+    int getEncoderThreads() const;
     bool isVectorFilterEnabled() const;
     bool isColorEnhancementEnabled() const;
 
     bool isSaveEnabled() const; // Method to check save state
 
+    bool isIncrementalFilteringEnabled() const;
+    double getChangeThreshold() const;
+    int getRefreshInterval() const;
+
+    bool isStackingEnabled() const;
+    QString getStackingMode() const;
+    int getStackingWindow() const;
+
+    QRect getRoi() const; // Null when the whole frame is processed
+
 private:
     QLineEdit *pathEdit;
     QComboBox *formatComboBox;
+    QSpinBox *encoderThreadsSpinBox; // 0 lets the encoder decide
     QPushButton *okButton;
     QPushButton *cancelButton;
     QPushButton *selectButton; // New button for selecting path
@@ -35,6 +50,20 @@ private:
     QCheckBox *colorEnhancementCheckbox; // Add this line
     QCheckBox *saveCheckBox; // Checkbox for saving
 
+    QCheckBox *incrementalCheckbox;    // Re-filter only the tiles that changed
+    QDoubleSpinBox *thresholdSpinBox;  // Mean absolute difference that marks a tile as changed
+    QSpinBox *refreshSpinBox;          // Forced full refresh every N frames
+
+    QCheckBox *stackingCheckbox;       // Aligned temporal averaging before the other instruments
+    QComboBox *stackingModeComboBox;
+    QSpinBox *stackingWindowSpinBox;
+
+    QCheckBox *roiCheckbox;            // Fixed region of interest for the filters
+    QSpinBox *roiXSpinBox;
+    QSpinBox *roiYSpinBox;
+    QSpinBox *roiWidthSpinBox;
+    QSpinBox *roiHeightSpinBox;
+
 
 public slots:
     void applyTheme(const QString &theme);
@@ -43,6 +72,9 @@ private slots:
     void acceptDialog();
     void selectPath(); // Slot for path selection
     void togglePathEdit(bool checked); // Slot to handle the toggle
+    void toggleIncrementalSettings(bool checked);
+    void toggleStackingSettings(bool checked);
+    void toggleRoiSettings(bool checked);
 };
 
 #endif // VIDEO_SETTINGS_H